@@ -1,20 +1,64 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <chrono>
+#include <cstring>
+#include <climits>
+#include <string>
+#include <atomic>
+#include "bezier.h"
+#include "tessellate.h"
+#include "bzsimd.h"
+#include "bzstream.h"
+#include "spline.h"
+#include "ptgrid.h"
+#include "bench.h"
+#include "editqueue.h"
+#include "bzfile.h"
+#include "arclen.h"
+#include "curvepick.h"
+#include "bounds.h"
+#include "tessbatch.h"
+#include "bgtess.h"
+#include "gpucurve.h"
+#include "stroke.h"
+#include "fill.h"
+#include "glyphatlas.h"
+#include "fitcurve.h"
 
 const int WIN_W = 800;
 const int WIN_H = 800;
 const float PT_RADIUS = 0.05f;
+const int CURVE_SAMPLES = 1001;
+const int CURVE_CAPACITY = (1 << ADAPT_MAX_DEPTH) + 1;
+const int MARKER_COUNT = 64;
+const float MARKER_SPEED = 0.25f;   // curve units per second
+const int LABEL_PX = 12;
+const float FIT_TOL_PX = 1.0f;
 
-struct BZpoint {
-    float x, y;
-    BZpoint mult(float s) const { return { x * s, y * s }; }
-    BZpoint add(BZpoint p) const { return { x + p.x, y + p.y }; }
-    float dist(BZpoint p) const {
-        return std::sqrt((x - p.x) * (x - p.x) + (y - p.y) * (y - p.y));
-    }
-};
+// Counts every C++ heap allocation so a drag can be checked for being allocation-free.
+// Atomic because the tessellation worker threads allocate too.
+std::atomic<size_t> allocCount(0);
+
+void* operator new(size_t n) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
 
 std::vector<BZpoint> pts = {
     {-0.7f, -0.3f},
@@ -22,82 +66,834 @@ std::vector<BZpoint> pts = {
     {0.1f, -0.5f},
     {0.5f, 0.3f}
 };
+BZgrid grid;
 int activeIdx = -1;
 
+// Input callbacks only queue edits; the render loop applies them and
+// rebuilds geometry at most once per frame.
+BZeditQueue editQueue;
+bool geomDirty = true;        // needs a full rebuild
+std::vector<int> movedPts;    // points moved since the last rebuild
+long long rebuilds = 0;
+
+size_t dragAllocStart = 0;
+long long dragEvents = 0, dragRebuilds = 0;
+// The last finished drag, for the window title.
+bool dragDone = false;
+long long dragEventCount = 0, dragBuilt = 0;
+size_t dragAllocs = 0;
+float dragDrift = 0;
+int dragFallbacks = 0;
+
 GLuint shaderProg;
-GLuint vao[3], vbo[3];
+GLuint vao[11], vbo[11];
+BZstream curveStream;
+size_t ptsCapacity = 0;
+size_t splineCapacity = 0;
+
+BZscratch scratch;
+BZfwdDiff fwdDiff;
+int curveCount = 0;
+
+// The Bezier curve is tessellated on a background thread; the stream keeps
+// the last complete result until a newer one arrives.
+BZbgTess bgTess;
+BZbgResult curveFront;
+
+// G toggles evaluating the uniform Bezier in the vertex shader; edits then
+// upload only the control points.
+BZgpuCurve gpuCurve;
+bool gpuEval = false;
+
+// Wide strokes (W cycles the width, J the join, C the cap). Width 0 keeps
+// the hairline GL_LINE_STRIPs. vbo[6] holds the strips of the control
+// polygon and the edited curve, vbo[7] those of the other curves.
+float strokePx = 0;
+BZstrokeStyle strokeStyle;
+BZstrokeScratch strokeScratch;
+std::vector<BZpoint> strokeVerts;
+int polyStroke = 0, curveStroke = 0;   // vertex counts in vbo[6]
+bool strokeDirty = true;
+std::vector<BZpoint> othersStrokeVerts;
+std::vector<GLint> othersStrokeFirst;
+std::vector<GLsizei> othersStrokeCount;
+
+// Fill of the edited curve, closed by a chord from its end back to its
+// start (F cycles off, even-odd, nonzero). A spline drag only re-sweeps
+// the heights spanned by the segments it changed. Triangles live in vbo[8].
+int fillMode = 0;             // FillRule + 1, 0 for no fill
+BZfill fill;
+bool fillFull = true;
+int fillLo = INT_MAX, fillHi = -1;   // spline vertices changed since the last fill
+int fillVerts = 0;
+double fillMs = 0;
+
+// Labels (L): the index of every control point and the id of every other
+// visible curve, drawn from a glyph atlas in one batch per frame. The font
+// is loaded on first use.
+bool labelsOn = false;
+BZfont font;
+BZglyphAtlas atlas;
+bool atlasReady = false;
+bool atlasFailed = false;   // not retried: the shader will not link on a later press either
+int labelGlyphs = 0, labelUploads = 0;
+
+// Freehand drawing (D): a left drag away from the control points is fitted
+// to cubics while it is drawn. They become new document curves on the next
+// save; until then they live in sketch, tessellated into vbo[9], and the
+// samples not yet fitted are drawn raw from vbo[10].
+bool freehand = false;
+bool sketching = false;
+BZfitter fitter;
+BZdoc sketch;
+std::vector<BZpoint> sketchVerts;
+std::vector<GLint> sketchFirst;
+std::vector<GLsizei> sketchCount;
+std::vector<BZpoint> sketchPoly(CURVE_CAPACITY);
+bool sketchDirty = false;
+long long sketchSamples = 0;
+
+bool adaptive = false;
+bool splineMode = false;
+BZspline spline;
+float tolPx = 0.5f;
+double tessMs = 0;
+bool statsChanged = true;
+
+// View transform: NDC = world * viewScale + viewOffset. Scroll zooms about
+// the cursor, arrow keys pan, Home resets. Curves outside the view are
+// neither tessellated nor drawn.
+float viewScale = 1;
+BZpoint viewOffset = { 0, 0 };
+int culledOthers = 0;
+bool culledEdit = false;
+
+// The document: pts is its first curve, copied out for editing. The other
+// curves are read straight from docFile (mapped for binary documents) and
+// only tessellated, on the worker pool, when loaded or when the view or
+// the tolerance changes.
+std::string docPath = "curves.bzc";
+BZdocFile docFile;
+bool docStructDirty = false;          // point count changed since the last save
+int docDirtyLo = INT_MAX, docDirtyHi = -1;
+bool othersDirty = true;
+BZpool pool;
+BZtessBatch othersBatch;
+std::vector<int> visibleOthers;
+double othersMs = 0;
+// Offset/count table into vbo[4], which holds every visible polyline; all
+// of them go out in one glMultiDrawArrays call.
+std::vector<GLint> otherFirst;
+std::vector<GLsizei> otherCount;
+
+// Markers moving at constant speed along the Bezier curve (M key).
+bool markersOn = false;
+BZarcLength arcLen;
+std::vector<float> markerDist(MARKER_COUNT), markerT(MARKER_COUNT);
+std::vector<BZpoint> markerPos(MARKER_COUNT);
+
+// Curve picking (Ctrl+click), rebuilt lazily after the geometry changed.
+// Curve ids below pickOthers are the edited curve: one id for the Bezier,
+// one per segment in spline mode; the other document curves follow.
+BZcurveIndex curveIndex;
+bool pickDirty = true;
+int pickOthers = 0;
+
+BZpoint screenToWorld(double x, double y) {
+    BZpoint ndc = { float(x / WIN_W * 2 - 1), float(1 - y / WIN_H * 2) };
+    return ndc.add(viewOffset.mult(-1)).mult(1 / viewScale);
+}
 
-BZpoint bezier(float t, const std::vector<BZpoint>& p) {
-    std::vector<BZpoint> tmp = p;
-    for (int k = 1; k < tmp.size(); ++k)
-        for (int i = 0; i < tmp.size() - k; ++i)
-            tmp[i] = tmp[i].mult(1 - t).add(tmp[i + 1].mult(t));
-    return tmp[0];
+BZpoint worldToScreen(BZpoint p) {
+    BZpoint ndc = p.mult(viewScale).add(viewOffset);
+    return { (ndc.x + 1) * 0.5f * WIN_W, (1 - ndc.y) * 0.5f * WIN_H };
+}
+
+BZbox viewBox() {
+    BZbox b;
+    b.grow(screenToWorld(0, WIN_H));
+    b.grow(screenToWorld(WIN_W, 0));
+    return b;
+}
+
+// Flatness tolerance and pick radius are fixed in pixels.
+float tolWorld() {
+    return tolPx * 2.0f / (WIN_W * viewScale);
+}
+
+float pickRadius() {
+    return PT_RADIUS / viewScale;
+}
+
+// The control-point box rejects most off-screen curves; the exact box is
+// only computed for the ones it cannot.
+bool curveVisible(const BZpoint* p, int n, const BZbox& view) {
+    return hullBox(p, n).overlaps(view) && exactBox(p, n, scratch).overlaps(view);
+}
+
+void viewChanged() {
+    othersDirty = true;
+    geomDirty = true;
+}
+
+// Control points only reallocate their buffers when they outgrow them.
+void uploadPoints() {
+    if (pts.size() > ptsCapacity) {
+        ptsCapacity = std::max(pts.size(), ptsCapacity * 2);
+        for (int i = 0; i < 2; ++i) {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo[i]);
+            glBufferData(GL_ARRAY_BUFFER, ptsCapacity * sizeof(BZpoint), nullptr, GL_DYNAMIC_DRAW);
+        }
+    }
+    for (int i = 0; i < 2; ++i) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo[i]);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, pts.size() * sizeof(BZpoint), pts.data());
+    }
+}
+
+// Uploads the spline segments changed since the last call.
+void uploadSpline() {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[3]);
+    size_t n = splineVertexCount(spline);
+    if (n > splineCapacity) {
+        splineCapacity = std::max(n, splineCapacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, splineCapacity * sizeof(BZpoint), nullptr, GL_DYNAMIC_DRAW);
+        spline.dirtyLo = 0;
+        spline.dirtyHi = spline.segs - 1;
+    }
+    if (spline.dirtyLo <= spline.dirtyHi) {
+        size_t first = size_t(spline.dirtyLo) * SEG_VERTS;
+        size_t count = size_t(spline.dirtyHi - spline.dirtyLo + 1) * SEG_VERTS;
+        fillLo = std::min(fillLo, int(first));
+        fillHi = std::max(fillHi, int(first + count) - 1);
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(BZpoint), count * sizeof(BZpoint), spline.verts.data() + first);
+    }
+    spline.dirtyLo = 0;
+    spline.dirtyHi = -1;
 }
 
 void updateBuffers() {
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-    glBufferData(GL_ARRAY_BUFFER, pts.size() * sizeof(BZpoint), pts.data(), GL_DYNAMIC_DRAW);
+    uploadPoints();
+
+    if (splineMode) {
+        fillFull = true;
+        auto t0 = std::chrono::steady_clock::now();
+        splineRebuild(spline, pts.data(), int(pts.size()));
+        tessMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        statsChanged = true;
+        uploadSpline();
+    }
+    else if (pts.size() >= 2) {
+        culledEdit = !curveVisible(pts.data(), int(pts.size()), viewBox());
+        statsChanged = true;
+        if (markersOn)
+            arcBuild(arcLen, pts.data(), int(pts.size()));
+        if (!culledEdit && gpuEval) {
+            gpuCurveUpload(gpuCurve, pts.data(), int(pts.size()));
+            curveCount = CURVE_SAMPLES;
+            return;
+        }
+        if (!culledEdit) {
+            bgSubmit(bgTess, pts.data(), int(pts.size()), adaptive, tolWorld(), CURVE_SAMPLES, CURVE_CAPACITY);
+            return;
+        }
+        // Results still in flight are ignored while culled.
+        fillFull = true;
+        BZpoint* out = streamBegin(curveStream);
+        if (!out) return;
+        curveCount = 0;
+        streamEnd(curveStream, 0);
+    }
+}
+
+// Uploads the newest background result, if one arrived.
+void fetchCurve() {
+    if (!bgFetch(bgTess, curveFront) || splineMode || culledEdit || gpuEval)
+        return;
+    strokeDirty = true;
+    fillFull = true;
+    BZpoint* out = streamBegin(curveStream);
+    if (!out) return;
+    std::copy(curveFront.verts.begin(), curveFront.verts.begin() + curveFront.count, out);
+    streamEnd(curveStream, curveFront.count);
+    curveCount = curveFront.count;
+    tessMs = curveFront.ms;
+    fwdDiff.maxDrift = std::max(fwdDiff.maxDrift, curveFront.maxDrift);
+    fwdDiff.fallbacks += curveFront.fallbacks;
+    statsChanged = true;
+}
+
+// Spaces the markers evenly by arc length and moves them along with time.
+void updateMarkers(double time) {
+    float total = arcLen.total;
+    if (total <= 0) return;
+    float phase = float(std::fmod(time * MARKER_SPEED, double(total)));
+    for (int i = 0; i < MARKER_COUNT; ++i)
+        markerDist[i] = std::fmod(phase + total * i / MARKER_COUNT, total);
+    arcParamBatch(arcLen, markerDist.data(), MARKER_COUNT, markerT.data());
+    bezierBatchAuto(pts.data(), int(pts.size()), markerT.data(), MARKER_COUNT, markerPos.data(), scratch);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[5]);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, MARKER_COUNT * sizeof(BZpoint), markerPos.data());
+}
+
+void addLabel(BZpoint world, const char* text) {
+    BZpoint p = worldToScreen(world);
+    if (p.x < -LABEL_PX || p.x > WIN_W || p.y < 0 || p.y > WIN_H + LABEL_PX) return;
+    textAdd(atlas, text, p.x + 6, p.y - 6, LABEL_PX);
+}
+
+void drawLabels() {
+    char text[24];
+    textBegin(atlas, WIN_W, WIN_H, 0.9f, 0.9f, 0.9f);
+    for (size_t i = 0; i < pts.size(); ++i) {
+        snprintf(text, sizeof(text), "%zu", i);
+        addLabel(pts[i], text);
+    }
+    const BZdocView& v = docFile.view;
+    for (int c : visibleOthers) {
+        snprintf(text, sizeof(text), "c%d", c);
+        addLabel(v.pts[v.curves[c].first], text);
+    }
+    textEnd(atlas);
+    if (atlas.glyphs != labelGlyphs || atlas.uploads > 0) {
+        labelGlyphs = atlas.glyphs;
+        labelUploads = atlas.uploads;
+        statsChanged = true;
+    }
+}
+
+void updateStrokeStyle() {
+    strokeStyle.width = strokePx * 2.0f / (WIN_W * viewScale);
+    strokeStyle.tol = tolWorld();
+}
+
+void strokeOthers() {
+    updateStrokeStyle();
+    int polys = int(othersBatch.count.size());
+    size_t cap = 0;
+    for (int c = 0; c < polys; ++c)
+        cap += strokeMaxVerts(int(othersBatch.count[c]), strokeStyle);
+    othersStrokeVerts.resize(cap);
+    othersStrokeFirst.resize(polys);
+    othersStrokeCount.resize(polys);
+    int total = strokeBatch(othersBatch.verts.data(), othersBatch.first.data(), othersBatch.count.data(), polys,
+        strokeStyle, othersStrokeVerts.data(), othersStrokeFirst.data(), othersStrokeCount.data(), strokeScratch);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[7]);
+    glBufferData(GL_ARRAY_BUFFER, total * sizeof(BZpoint), othersStrokeVerts.data(), GL_STATIC_DRAW);
+}
+
+// Strokes the control polygon and, unless the shader evaluates it, the
+// edited curve from the CPU-side vertices.
+void strokeEdited() {
+    updateStrokeStyle();
+    const BZpoint* curve = nullptr;
+    int n = 0;
+    if (splineMode) {
+        curve = spline.verts.data();
+        n = int(splineVertexCount(spline));
+    }
+    else if (!gpuEval && !culledEdit) {
+        curve = curveFront.verts.data();
+        n = curveFront.count;
+    }
+    size_t cap = size_t(strokeMaxVerts(int(pts.size()), strokeStyle)) + strokeMaxVerts(n, strokeStyle);
+    if (strokeVerts.size() < cap)
+        strokeVerts.resize(std::max(cap, strokeVerts.size() * 2));
+    polyStroke = strokePolyline(pts.data(), int(pts.size()), strokeStyle, strokeVerts.data(), strokeScratch);
+    curveStroke = strokePolyline(curve, n, strokeStyle, strokeVerts.data() + polyStroke, strokeScratch);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[6]);
+    glBufferData(GL_ARRAY_BUFFER, (polyStroke + curveStroke) * sizeof(BZpoint), strokeVerts.data(), GL_DYNAMIC_DRAW);
+    strokeDirty = false;
+}
+
+void updateFill() {
+    if (!fillMode || (!fillFull && fillLo > fillHi)) return;
+    const BZpoint* p = nullptr;
+    int n = 0;
+    if (splineMode) {
+        p = spline.verts.data();
+        n = splineVertexCount(spline);
+    }
+    else if (!gpuEval && !culledEdit) {
+        p = curveFront.verts.data();
+        n = curveFront.count;
+    }
+    FillRule rule = FillRule(fillMode - 1);
+    auto t0 = std::chrono::steady_clock::now();
+    if (fillFull || int(fill.pts.size()) != n || fill.rule != rule)
+        fillVerts = fillBuild(fill, p, &n, n >= 3 ? 1 : 0, rule);
+    else
+        fillVerts = fillUpdate(fill, p, fillLo, fillHi);
+    fillMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    fillFull = false;
+    fillLo = INT_MAX;
+    fillHi = -1;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[8]);
+    glBufferData(GL_ARRAY_BUFFER, fillVerts * sizeof(BZpoint), fill.tris.data(), GL_DYNAMIC_DRAW);
+    statsChanged = true;
+}
+
+// Tessellates sketch curves [from, end) onto sketchVerts.
+void tessellateSketch(size_t from) {
+    for (size_t c = from; c < sketch.curves.size(); ++c) {
+        int n = bezierAdaptive(&sketch.pts[sketch.curves[c].first], 4, tolWorld(), sketchPoly.data(),
+            CURVE_CAPACITY, scratch);
+        sketchFirst.push_back(GLint(sketchVerts.size()));
+        sketchCount.push_back(n);
+        sketchVerts.insert(sketchVerts.end(), sketchPoly.begin(), sketchPoly.begin() + n);
+    }
+    sketchDirty = true;
+}
+
+// Takes the last n cubics the fitter committed into the sketch.
+void addSketchSegments(int n) {
+    if (n <= 0) return;
+    size_t from = sketch.curves.size();
+    for (int k = n; k > 0; --k)
+        sketch.addCurve(&fitter.segs[fitter.segs.size() - 1 - 3 * k], 4);
+    tessellateSketch(from);
+    statsChanged = true;
+}
+
+void updateSketch() {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[9]);
+    glBufferData(GL_ARRAY_BUFFER, sketchVerts.size() * sizeof(BZpoint), sketchVerts.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[10]);
+    glBufferData(GL_ARRAY_BUFFER, fitter.run.size() * sizeof(BZpoint), fitter.run.data(), GL_STREAM_DRAW);
+    sketchDirty = false;
+}
+
+void tessellateOthers() {
+    const BZdocView& v = docFile.view;
+    BZbox view = viewBox();
+    visibleOthers.clear();
+    culledOthers = 0;
+    for (uint32_t c = 1; c < v.curveCount; ++c) {
+        int n = int(v.curves[c].count);
+        if (n < 2) continue;
+        if (curveVisible(v.pts + v.curves[c].first, n, view))
+            visibleOthers.push_back(int(c));
+        else
+            ++culledOthers;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    tessBatch(pool, othersBatch, v, visibleOthers.data(), int(visibleOthers.size()), tolWorld());
+    othersMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    otherFirst.assign(othersBatch.first.begin(), othersBatch.first.end());
+    otherCount.assign(othersBatch.count.begin(), othersBatch.count.end());
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[4]);
+    glBufferData(GL_ARRAY_BUFFER, othersBatch.verts.size() * sizeof(BZpoint), othersBatch.verts.data(), GL_STATIC_DRAW);
+    if (strokePx > 0)
+        strokeOthers();
+    sketchVerts.clear();
+    sketchFirst.clear();
+    sketchCount.clear();
+    tessellateSketch(0);
+    othersDirty = false;
+    pickDirty = true;
+    statsChanged = true;
+}
+
+void updatePickIndex() {
+    if (!pickDirty) return;
+    pickClear(curveIndex);
+    int m = int(pts.size());
+    if (splineMode) {
+        BZpoint b[4];
+        for (int s = 0; s < splineSegments(spline.kind, m); ++s) {
+            splineSegment(spline.kind, pts.data(), m, s, b);
+            pickAddCurve(curveIndex, b, 4);
+        }
+    }
+    else
+        pickAddCurve(curveIndex, pts.data(), m);
+    pickOthers = int(curveIndex.curves.size());
+    const BZdocView& v = docFile.view;
+    for (uint32_t c = 1; c < v.curveCount; ++c)
+        pickAddCurve(curveIndex, v.pts + v.curves[c].first, int(v.curves[c].count));
+    pickBuild(curveIndex);
+    pickDirty = false;
+}
+
+// Ctrl+click: puts a new point on the nearest curve. On the edited curve it
+// goes between the control points around the hit; on another curve it is
+// appended, snapped onto that curve.
+bool insertOnCurve(BZpoint mouse) {
+    updatePickIndex();
+    BZpickHit hit;
+    if (!pickClosest(curveIndex, mouse, pickRadius(), hit))
+        return false;
+    int m = int(pts.size());
+    int idx = m;
+    if (hit.curve < pickOthers) {
+        if (splineMode)
+            idx = splineBase(spline.kind, hit.curve) + 2;
+        else
+            idx = int(hit.t * (m - 1)) + 1;
+        idx = std::min(std::max(idx, 0), m);
+    }
+    queueEdit(editQueue, EDIT_INSERT, idx, hit.pos);
+    return true;
+}
+
+bool loadDocument(const char* path) {
+    std::string err;
+    docPath = path;
+    if (!bzOpen(path, docFile, err)) {
+        printf("%s: %s\n", path, err.c_str());
+        return false;
+    }
+    const BZdocView& v = docFile.view;
+    if (v.curveCount > 0)
+        pts.assign(v.pts + v.curves[0].first, v.pts + v.curves[0].first + v.curves[0].count);
+    printf("%s: %u curves, %llu points\n", path, v.curveCount, (unsigned long long)v.pointCount);
+    return true;
+}
+
+// Saves pts as the first curve. If only points moved since the last save of
+// a binary document, just those bytes are rewritten; otherwise the whole file
+// is written next to the original and swapped in.
+void saveDocument() {
+    std::string err;
+    const BZdocView& v = docFile.view;
+    bool binary = docFile.map.data != nullptr;
+    bool sameLayout = binary && !docStructDirty && sketch.curves.empty() && v.curveCount > 0 &&
+        v.curves[0].count == pts.size();
+    bool ok = true;
+    if (sameLayout) {
+        if (docDirtyLo <= docDirtyHi)
+            ok = bzPatchPoints(docPath.c_str(), v.curveCount, v.curves[0].first + docDirtyLo,
+                pts.data() + docDirtyLo, uint64_t(docDirtyHi - docDirtyLo + 1), err);
+        if (ok)
+            printf("%s: saved %d points\n", docPath.c_str(), docDirtyHi >= docDirtyLo ? docDirtyHi - docDirtyLo + 1 : 0);
+    }
+    else {
+        BZdoc out;
+        out.addCurve(pts.data(), pts.size());
+        for (uint32_t c = 1; c < v.curveCount; ++c)
+            out.addCurve(v.pts + v.curves[c].first, size_t(v.curves[c].count));
+        for (const BZcurveRec& r : sketch.curves)
+            out.addCurve(&sketch.pts[r.first], size_t(r.count));
+        std::string tmp = docPath + ".tmp";
+        ok = bzExport(tmp.c_str(), out.view(), bzIsTextPath(docPath.c_str()), err);
+        if (ok) {
+            bzClose(docFile);
+            if (!bzReplaceFile(tmp.c_str(), docPath.c_str())) {
+                err = "cannot replace " + docPath;
+                ok = false;
+            }
+            // Reopen either way so the other curves stay available.
+            std::string reopenErr;
+            if (!bzOpen(docPath.c_str(), docFile, reopenErr))
+                printf("%s\n", reopenErr.c_str());
+        }
+        if (ok)
+            printf("%s: saved %u curves\n", docPath.c_str(), out.view().curveCount);
+    }
+    if (!ok) {
+        printf("save failed: %s\n", err.c_str());
+        return;
+    }
+    docStructDirty = false;
+    docDirtyLo = INT_MAX;
+    docDirtyHi = -1;
+    if (!sketch.curves.empty()) {
+        // The sketch is part of the document now.
+        sketch = BZdoc();
+        sketchSamples = 0;
+        othersDirty = true;
+        geomDirty = true;
+    }
+}
+
+// Spline point i moved: only the segments using it are re-tessellated.
+// The caller uploads the spline afterwards.
+void updateSplinePoint(int i) {
+    for (int b = 0; b < 2; ++b) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo[b]);
+        glBufferSubData(GL_ARRAY_BUFFER, i * sizeof(BZpoint), sizeof(BZpoint), &pts[i]);
+    }
+    splineMovePoint(spline, pts.data(), int(pts.size()), i);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-    glBufferData(GL_ARRAY_BUFFER, pts.size() * sizeof(BZpoint), pts.data(), GL_DYNAMIC_DRAW);
+// Applies queued edits to the points and the grid; geometry is left to
+// rebuildGeometry().
+void applyEdits() {
+    if (!editQueue.edits.empty())
+        pickDirty = true;
+    for (const BZedit& e : editQueue.edits) {
+        switch (e.kind) {
+        case EDIT_MOVE:
+            pts[e.idx] = e.pos;
+            gridMove(grid, e.idx, e.pos);
+            if (movedPts.empty() || movedPts.back() != e.idx)
+                movedPts.push_back(e.idx);
+            docDirtyLo = std::min(docDirtyLo, e.idx);
+            docDirtyHi = std::max(docDirtyHi, e.idx);
+            break;
+        case EDIT_INSERT:
+            pts.insert(pts.begin() + e.idx, e.pos);
+            gridInsert(grid, pts.data(), int(pts.size()), e.idx);
+            geomDirty = true;
+            docStructDirty = true;
+            break;
+        case EDIT_ERASE:
+            pts.erase(pts.begin() + e.idx);
+            gridErase(grid, e.idx);
+            geomDirty = true;
+            docStructDirty = true;
+            break;
+        }
+    }
+    editQueue.edits.clear();
+}
 
-    if (pts.size() >= 2) {
-        std::vector<BZpoint> curve;
-        for (float t = 0; t <= 1.0f; t += 0.001f)
-            curve.push_back(bezier(t, pts));
-        glBindBuffer(GL_ARRAY_BUFFER, vbo[2]);
-        glBufferData(GL_ARRAY_BUFFER, curve.size() * sizeof(BZpoint), curve.data(), GL_DYNAMIC_DRAW);
+// Once per frame. Moves on a spline only touch their segments; anything
+// else re-tessellates the whole curve.
+void rebuildGeometry() {
+    applyEdits();
+    fetchCurve();
+    if (othersDirty)
+        tessellateOthers();
+    if (!geomDirty && movedPts.empty()) {
+        if (strokeDirty && strokePx > 0)
+            strokeEdited();
+        updateFill();
+        return;
     }
+    pickDirty = true;
+    strokeDirty = true;
+    if (!geomDirty && splineMode) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i : movedPts)
+            updateSplinePoint(i);
+        tessMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        statsChanged = true;
+        uploadSpline();
+    }
+    else
+        updateBuffers();
+    geomDirty = false;
+    movedPts.clear();
+    ++rebuilds;
+    if (strokePx > 0)
+        strokeEdited();
+    updateFill();
 }
 
 void mouseBtn(GLFWwindow* win, int btn, int act, int mods) {
     double mx, my;
     glfwGetCursorPos(win, &mx, &my);
-    BZpoint mouse = {
-        float(mx / WIN_W * 2 - 1),
-        float(1 - my / WIN_H * 2)
-    };
+    BZpoint mouse = screenToWorld(mx, my);
+
+    // Hit tests need the points as of the last queued edit.
+    applyEdits();
 
     if (btn == GLFW_MOUSE_BUTTON_LEFT && act == GLFW_PRESS) {
-        for (int i = 0; i < pts.size(); ++i) {
-            if (pts[i].dist(mouse) < PT_RADIUS) {
-                activeIdx = i;
-                return;
-            }
+        int i = gridPick(grid, pts.data(), mouse, pickRadius());
+        if (i >= 0) {
+            activeIdx = i;
+            dragAllocStart = allocCount.load();
+            dragEvents = editQueue.recorded;
+            dragRebuilds = rebuilds;
+            fwdDiff.resetStats();
+            return;
         }
-        pts.push_back(mouse);
-        updateBuffers();
+        if ((mods & GLFW_MOD_CONTROL) && insertOnCurve(mouse))
+            return;
+        if (freehand) {
+            fitter.tol = FIT_TOL_PX * 2.0f / (WIN_W * viewScale);
+            fitBegin(fitter, mouse);
+            sketching = true;
+            sketchDirty = true;
+            return;
+        }
+        queueEdit(editQueue, EDIT_INSERT, int(pts.size()), mouse);
     }
     else if (btn == GLFW_MOUSE_BUTTON_RIGHT && act == GLFW_PRESS) {
-        for (int i = 0; i < pts.size(); ++i) {
-            if (pts[i].dist(mouse) < PT_RADIUS) {
-                pts.erase(pts.begin() + i);
-                updateBuffers();
-                return;
-            }
-        }
+        int i = gridPick(grid, pts.data(), mouse, pickRadius());
+        if (i >= 0)
+            queueEdit(editQueue, EDIT_ERASE, i, mouse);
     }
     else if (btn == GLFW_MOUSE_BUTTON_LEFT && act == GLFW_RELEASE) {
+        if (sketching) {
+            addSketchSegments(fitEnd(fitter));
+            sketching = false;
+            sketchDirty = true;
+            sketchSamples += fitter.samples;
+            // Each cubic is saved as its own 4-point curve.
+            int cubics = (int(fitter.segs.size()) - 1) / 3;
+            if (cubics > 0)
+                printf("freehand: %lld samples -> %d cubics (%d points, %.1fx fewer), longest run %d samples\n",
+                    fitter.samples, cubics, 4 * cubics, double(fitter.samples) / (4 * cubics), fitter.longestRun);
+        }
+        if (activeIdx >= 0) {
+            dragDone = true;
+            dragEventCount = editQueue.recorded - dragEvents;
+            dragBuilt = rebuilds - dragRebuilds;
+            dragAllocs = allocCount.load() - dragAllocStart;
+            dragDrift = fwdDiff.maxDrift;
+            dragFallbacks = fwdDiff.fallbacks;
+            statsChanged = true;
+        }
         activeIdx = -1;
     }
 }
 
 void mouseMove(GLFWwindow* win, double x, double y) {
+    if (sketching) {
+        addSketchSegments(fitAdd(fitter, screenToWorld(x, y)));
+        sketchDirty = true;
+    }
     if (activeIdx >= 0) {
-        pts[activeIdx] = {
-            float(x / WIN_W * 2 - 1),
-            float(1 - y / WIN_H * 2)
-        };
-        updateBuffers();
+        queueEdit(editQueue, EDIT_MOVE, activeIdx, screenToWorld(x, y));
+    }
+}
+
+void keyPress(GLFWwindow* win, int key, int scancode, int act, int mods) {
+    if (act != GLFW_PRESS && act != GLFW_REPEAT) return;
+    if (key == GLFW_KEY_S && (mods & GLFW_MOD_CONTROL)) {
+        applyEdits();
+        saveDocument();
+        return;
+    }
+    if (key >= GLFW_KEY_RIGHT && key <= GLFW_KEY_UP) {
+        const float step = 0.25f;
+        viewOffset.x += key == GLFW_KEY_LEFT ? step : (key == GLFW_KEY_RIGHT ? -step : 0);
+        viewOffset.y += key == GLFW_KEY_DOWN ? step : (key == GLFW_KEY_UP ? -step : 0);
+        viewChanged();
+        return;
+    }
+    if (key == GLFW_KEY_HOME) {
+        viewScale = 1;
+        viewOffset = { 0, 0 };
+        viewChanged();
+        return;
+    }
+    if (key == GLFW_KEY_L) {
+        if (!labelsOn && !atlasReady && !atlasFailed) {
+            std::string err;
+            if (!fontLoadDefault(font, err)) {
+                printf("labels: %s\n", err.c_str());
+                return;
+            }
+            atlasReady = atlasInit(atlas, font, LABEL_PX);
+            atlasFailed = !atlasReady;
+            if (atlasFailed)
+                printf("labels: atlas shader failed to link\n");
+        }
+        labelsOn = !labelsOn && atlasReady;
+        statsChanged = true;
+        return;
+    }
+    if (key == GLFW_KEY_D) {
+        freehand = !freehand;
+        statsChanged = true;
+        return;
+    }
+    if (key == GLFW_KEY_M) {
+        markersOn = !markersOn;
+        geomDirty = true;
+        return;
+    }
+    if (key == GLFW_KEY_A)
+        adaptive = !adaptive;
+    else if (key == GLFW_KEY_G)
+        gpuEval = !gpuEval && gpuCurve.ok;
+    else if (key == GLFW_KEY_W) {
+        strokePx = strokePx >= 16 ? 0 : std::max(strokePx * 2, 2.0f);
+        othersDirty = true;
+    }
+    else if (key == GLFW_KEY_J) {
+        strokeStyle.join = StrokeJoin((strokeStyle.join + 1) % 3);
+        othersDirty = true;
+    }
+    else if (key == GLFW_KEY_F)
+        fillMode = (fillMode + 1) % 3;
+    else if (key == GLFW_KEY_C) {
+        strokeStyle.cap = StrokeCap((strokeStyle.cap + 1) % 3);
+        othersDirty = true;
+    }
+    else if (key == GLFW_KEY_S) {
+        // Cycles global Bezier -> B-spline -> Catmull-Rom.
+        if (!splineMode) {
+            splineMode = true;
+            spline.kind = SPLINE_BSPLINE;
+        }
+        else if (spline.kind == SPLINE_BSPLINE)
+            spline.kind = SPLINE_CATMULL_ROM;
+        else
+            splineMode = false;
+    }
+    else if (key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD) {
+        tolPx *= 2;
+        othersDirty = true;
+    }
+    else if (key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT) {
+        tolPx = std::fmax(tolPx / 2, 1.0f / 64);
+        othersDirty = true;
     }
+    else
+        return;
+    geomDirty = true;
+    fillFull = true;
+}
+
+// Zooms by 1.25 per wheel step, keeping the point under the cursor fixed.
+void scroll(GLFWwindow* win, double dx, double dy) {
+    double mx, my;
+    glfwGetCursorPos(win, &mx, &my);
+    BZpoint anchor = screenToWorld(mx, my);
+    viewScale = std::min(std::max(viewScale * std::pow(1.25f, float(dy)), 1.0f / 64), 4096.0f);
+    BZpoint ndc = { float(mx / WIN_W * 2 - 1), float(1 - my / WIN_H * 2) };
+    viewOffset = ndc.add(anchor.mult(-viewScale));
+    viewChanged();
+}
+
+void showStats(GLFWwindow* win) {
+    char title[448];
+    int n;
+    if (splineMode)
+        n = snprintf(title, sizeof(title), "Bezier - %s: %d segments, %.3f ms",
+            spline.kind == SPLINE_BSPLINE ? "B-spline" : "Catmull-Rom", spline.segs, tessMs);
+    else if (gpuEval)
+        n = snprintf(title, sizeof(title), "Bezier - GPU: %d verts from %zu points, %zu bytes/edit",
+            curveCount, pts.size(), pts.size() * sizeof(BZpoint));
+    else if (adaptive)
+        n = snprintf(title, sizeof(title), "Bezier - adaptive %.3g px: %d verts, %.3f ms", tolPx, curveCount, tessMs);
+    else
+        n = snprintf(title, sizeof(title), "Bezier - uniform: %d verts, %.3f ms", curveCount, tessMs);
+    uint32_t curves = std::max(docFile.view.curveCount, 1u);
+    int culled = culledOthers + (culledEdit && !splineMode ? 1 : 0);
+    n += snprintf(title + n, sizeof(title) - n, ", %d/%u curves culled", culled, curves);
+    if (fillMode)
+        n += snprintf(title + n, sizeof(title) - n, ", %s fill %d tris %.3f ms",
+            FILL_RULE_NAMES[fillMode - 1], fillVerts / 3, fillMs);
+    if (strokePx > 0)
+        n += snprintf(title + n, sizeof(title) - n, ", %g px %s/%s", strokePx,
+            JOIN_NAMES[strokeStyle.join], CAP_NAMES[strokeStyle.cap]);
+    if (freehand || !sketch.curves.empty())
+        n += snprintf(title + n, sizeof(title) - n, ", freehand %zu cubics from %lld samples",
+            sketch.curves.size(), sketchSamples);
+    if (labelsOn)
+        n += snprintf(title + n, sizeof(title) - n, ", labels %d glyphs, %d uploaded", labelGlyphs, labelUploads);
+    if (dragDone)
+        n += snprintf(title + n, sizeof(title) - n, ", drag %lld events %lld rebuilds %zu allocs drift %.2g/%d",
+            dragEventCount, dragBuilt, dragAllocs, dragDrift, dragFallbacks);
+    if (!otherCount.empty())
+        snprintf(title + n, sizeof(title) - n, ", others %.2f ms on %d threads", othersMs, poolSize(pool));
+    glfwSetWindowTitle(win, title);
+    statsChanged = false;
 }
 
 const char* vertShader = R"(
 #version 330
 layout(location=0) in vec2 pos;
+uniform vec3 view;
 void main() {
-    gl_Position = vec4(pos, 0.0, 1.0);
+    gl_Position = vec4(pos * view.x + view.yz, 0.0, 1.0);
 }
 )";
 
@@ -129,17 +925,78 @@ void initShaders() {
 }
 
 void initGL() {
-    glGenVertexArrays(3, vao);
-    glGenBuffers(3, vbo);
-    for (int i = 0; i < 3; ++i) {
+    glGenVertexArrays(11, vao);
+    glGenBuffers(11, vbo);
+    for (int i = 0; i < 11; ++i) {
         glBindVertexArray(vao[i]);
         glBindBuffer(GL_ARRAY_BUFFER, vbo[i]);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
         glEnableVertexAttribArray(0);
     }
+    streamInit(curveStream, vao[2], vbo[2], CURVE_CAPACITY);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[5]);
+    glBufferData(GL_ARRAY_BUFFER, MARKER_COUNT * sizeof(BZpoint), nullptr, GL_DYNAMIC_DRAW);
+}
+
+// Frame time of a drag, CPU tessellation plus upload against control-point
+// upload plus shader evaluation, finished with glFinish so the GPU work
+// is counted too.
+void benchGpu(GLFWwindow* win) {
+    const int FRAMES = 200;
+    printf("gpu: %s\n", (const char*)glGetString(GL_RENDERER));
+    if (!gpuCurve.ok) {
+        printf("gpu: evaluation shader failed to link\n");
+        return;
+    }
+    std::vector<float> ts(CURVE_SAMPLES);
+    uniformParams(ts.data(), CURVE_SAMPLES);
+    glUseProgram(shaderProg);
+    glUniform3f(glGetUniformLocation(shaderProg, "view"), 1.0f, 0.0f, 0.0f);
+    glUniform3f(glGetUniformLocation(shaderProg, "col"), 0.0f, 1.0f, 0.0f);
+    for (int n : { 4, 16, 64, 256 }) {
+        std::vector<BZpoint> p(n);
+        for (int i = 0; i < n; ++i)
+            p[i] = { -0.9f + 1.8f * i / (n - 1), 0.8f * std::sin(i * 1.7f) };
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int f = 0; f < FRAMES; ++f) {
+            p[n / 2].y = std::sin(f * 0.05f);
+            BZpoint* out = streamBegin(curveStream);
+            if (n - 1 <= FD_MAX_DEGREE)
+                tessUniform(p.data(), n, ts.data(), CURVE_SAMPLES, out, fwdDiff, scratch);
+            else
+                bezierBatchAuto(p.data(), n, ts.data(), CURVE_SAMPLES, out, scratch);
+            streamEnd(curveStream, CURVE_SAMPLES);
+            glUseProgram(shaderProg);
+            glBindVertexArray(vao[2]);
+            streamDraw(curveStream, GL_LINE_STRIP);
+            glFinish();
+        }
+        double cpu = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / FRAMES;
+
+        t0 = std::chrono::steady_clock::now();
+        for (int f = 0; f < FRAMES; ++f) {
+            p[n / 2].y = std::sin(f * 0.05f);
+            gpuCurveUpload(gpuCurve, p.data(), n);
+            gpuCurveDraw(gpuCurve, CURVE_SAMPLES, 1.0f, { 0, 0 }, 0.0f, 1.0f, 0.0f);
+            glFinish();
+        }
+        double gpu = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / FRAMES;
+
+        printf("gpu n=%d: cpu path %.3f ms/frame (%zu bytes/edit), gpu path %.3f ms/frame (%zu bytes/edit)\n",
+            n, cpu, CURVE_SAMPLES * sizeof(BZpoint), gpu, n * sizeof(BZpoint));
+        glfwSwapBuffers(win);
+    }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        runBenchmarks();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-gpu") != 0)
+        loadDocument(argv[1]);
+
     if (!glfwInit()) return -1;
 
     GLFWwindow* win = glfwCreateWindow(WIN_W, WIN_H, "Bezier", NULL, NULL);
@@ -151,31 +1008,122 @@ int main() {
     glfwMakeContextCurrent(win);
     glewInit();
 
+    gridBuild(grid, pts.data(), int(pts.size()), PT_RADIUS);
+    printf("simd: %s\n", SIMD_NAMES[simdLevel()]);
+
+    poolStart(pool, 0);
+    bgStart(bgTess);
+    editQueue.edits.reserve(256);
+    movedPts.reserve(16);
+
     initShaders();
     initGL();
-    updateBuffers();
+    gpuCurveInit(gpuCurve, fragShader);
+    if (argc > 1 && strcmp(argv[1], "--bench-gpu") == 0) {
+        benchGpu(win);
+        glfwTerminate();
+        return 0;
+    }
 
     glfwSetMouseButtonCallback(win, mouseBtn);
     glfwSetCursorPosCallback(win, mouseMove);
+    glfwSetKeyCallback(win, keyPress);
+    glfwSetScrollCallback(win, scroll);
 
     while (!glfwWindowShouldClose(win)) {
+        rebuildGeometry();
+
         glClear(GL_COLOR_BUFFER_BIT);
         glUseProgram(shaderProg);
+        glUniform3f(glGetUniformLocation(shaderProg, "view"), viewScale, viewOffset.x, viewOffset.y);
+
+        if (fillMode && fillVerts > 0) {
+            glUniform3f(glGetUniformLocation(shaderProg, "col"), 0.15f, 0.3f, 0.15f);
+            glBindVertexArray(vao[8]);
+            glDrawArrays(GL_TRIANGLES, 0, fillVerts);
+        }
 
         glUniform3f(glGetUniformLocation(shaderProg, "col"), 1.0f, 0.0f, 0.0f);
         glBindVertexArray(vao[0]);
         glPointSize(10.0f);
         glDrawArrays(GL_POINTS, 0, pts.size());
 
+        bool stroked = strokePx > 0;
         glUniform3f(glGetUniformLocation(shaderProg, "col"), 0.0f, 0.0f, 1.0f);
-        glBindVertexArray(vao[1]);
-        glDrawArrays(GL_LINE_STRIP, 0, pts.size());
+        if (stroked) {
+            glBindVertexArray(vao[6]);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, polyStroke);
+        }
+        else {
+            glBindVertexArray(vao[1]);
+            glDrawArrays(GL_LINE_STRIP, 0, pts.size());
+        }
+
+        if (!otherCount.empty()) {
+            glUniform3f(glGetUniformLocation(shaderProg, "col"), 0.5f, 0.5f, 0.5f);
+            if (stroked) {
+                glBindVertexArray(vao[7]);
+                glMultiDrawArrays(GL_TRIANGLE_STRIP, othersStrokeFirst.data(), othersStrokeCount.data(),
+                    GLsizei(othersStrokeCount.size()));
+            }
+            else {
+                glBindVertexArray(vao[4]);
+                glMultiDrawArrays(GL_LINE_STRIP, otherFirst.data(), otherCount.data(), GLsizei(otherCount.size()));
+            }
+        }
+
+        if (sketchDirty)
+            updateSketch();
+        if (!sketchCount.empty() || sketching) {
+            glUniform3f(glGetUniformLocation(shaderProg, "col"), 1.0f, 0.6f, 0.0f);
+            glBindVertexArray(vao[9]);
+            glMultiDrawArrays(GL_LINE_STRIP, sketchFirst.data(), sketchCount.data(), GLsizei(sketchCount.size()));
+            if (sketching) {
+                glBindVertexArray(vao[10]);
+                glDrawArrays(GL_LINE_STRIP, 0, GLsizei(fitter.run.size()));
+            }
+        }
 
-        if (pts.size() >= 2) {
+        if (splineMode) {
             glUniform3f(glGetUniformLocation(shaderProg, "col"), 0.0f, 1.0f, 0.0f);
-            glBindVertexArray(vao[2]);
-            glDrawArrays(GL_LINE_STRIP, 0, 1001);
+            if (stroked) {
+                glBindVertexArray(vao[6]);
+                glDrawArrays(GL_TRIANGLE_STRIP, polyStroke, curveStroke);
+            }
+            else {
+                glBindVertexArray(vao[3]);
+                glDrawArrays(GL_LINE_STRIP, 0, splineVertexCount(spline));
+            }
         }
+        else if (pts.size() >= 2) {
+            glUniform3f(glGetUniformLocation(shaderProg, "col"), 0.0f, 1.0f, 0.0f);
+            if (gpuEval && !culledEdit) {
+                gpuCurveDraw(gpuCurve, CURVE_SAMPLES, viewScale, viewOffset, 0.0f, 1.0f, 0.0f);
+                glUseProgram(shaderProg);
+            }
+            else if (stroked) {
+                glBindVertexArray(vao[6]);
+                glDrawArrays(GL_TRIANGLE_STRIP, polyStroke, curveStroke);
+            }
+            else {
+                glBindVertexArray(vao[2]);
+                streamDraw(curveStream, GL_LINE_STRIP);
+            }
+
+            if (markersOn) {
+                updateMarkers(glfwGetTime());
+                glUniform3f(glGetUniformLocation(shaderProg, "col"), 1.0f, 1.0f, 0.0f);
+                glBindVertexArray(vao[5]);
+                glPointSize(6.0f);
+                glDrawArrays(GL_POINTS, 0, MARKER_COUNT);
+            }
+        }
+
+        if (labelsOn)
+            drawLabels();
+
+        if (statsChanged)
+            showStats(win);
 
         glfwSwapBuffers(win);
         glfwPollEvents();
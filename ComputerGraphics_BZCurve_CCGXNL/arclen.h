@@ -0,0 +1,157 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "bezier.h"
+#include "tessellate.h"
+
+// Arc-length table for constant-speed motion along a curve. The parameter
+// range is split into ARC_INTERVALS equal pieces; the length of each is
+// integrated with 5-point Gauss-Legendre quadrature over |P'(t)|.
+//
+// Distance -> t: binary search for the interval, an initial guess from the
+// cubic Hermite model of s(t) on that interval (node lengths and speeds), then
+// one Newton step on the true arc length.
+
+const int ARC_INTERVALS = 64;
+const int GAUSS_N = 5;
+const double GAUSS_X[GAUSS_N] = { -0.9061798459386640, -0.5384693101056831, 0.0, 0.5384693101056831, 0.9061798459386640 };
+const double GAUSS_W[GAUSS_N] = { 0.2369268850561891, 0.4786286704993665, 0.5688888888888889, 0.4786286704993665, 0.2369268850561891 };
+
+struct BZarcLength {
+    std::vector<BZpoint> hodo;   // derivative control points
+    std::vector<float> s;        // length up to node i, ARC_INTERVALS + 1 entries
+    std::vector<float> v;        // speed |P'| at node i
+    float total = 0;
+
+    // Query scratch, grown as needed.
+    std::vector<float> qt;
+    std::vector<BZpoint> qd;
+    std::vector<int> qi;
+    BZscratch scratch;
+};
+
+inline float arcNode(int i) {
+    return float(i) / ARC_INTERVALS;
+}
+
+inline float speedOf(BZpoint d) {
+    return std::sqrt(d.x * d.x + d.y * d.y);
+}
+
+// Builds the table for p; call again after every edit of the curve.
+inline void arcBuild(BZarcLength& a, const BZpoint* p, int n) {
+    const int N = ARC_INTERVALS;
+    a.s.assign(N + 1, 0.0f);
+    a.v.assign(N + 1, 0.0f);
+    a.total = 0;
+    if (n < 2) return;
+    a.hodo.resize(n - 1);
+    hodograph(p, n, a.hodo.data());
+
+    // Nodes first, then GAUSS_N quadrature points per interval.
+    int m = N + 1 + N * GAUSS_N;
+    a.qt.resize(m);
+    a.qd.resize(m);
+    for (int i = 0; i <= N; ++i)
+        a.qt[i] = arcNode(i);
+    for (int i = 0; i < N; ++i)
+        for (int k = 0; k < GAUSS_N; ++k)
+            a.qt[N + 1 + i * GAUSS_N + k] = float(arcNode(i) + (GAUSS_X[k] + 1) * 0.5 / N);
+    bezierBatchAuto(a.hodo.data(), n - 1, a.qt.data(), m, a.qd.data(), a.scratch);
+
+    double sum = 0;
+    for (int i = 0; i <= N; ++i) {
+        a.v[i] = speedOf(a.qd[i]);
+        a.s[i] = float(sum);
+        if (i == N) break;
+        double seg = 0;
+        for (int k = 0; k < GAUSS_N; ++k)
+            seg += GAUSS_W[k] * speedOf(a.qd[N + 1 + i * GAUSS_N + k]);
+        sum += seg * 0.5 / N;
+    }
+    a.total = float(sum);
+}
+
+// Largest power of two <= n: the first step of the interval search.
+constexpr int arcSearchStep(int n, int p = 1) {
+    return p * 2 > n ? p : arcSearchStep(n, p * 2);
+}
+
+// Interval containing distance d: largest i < N with s[i] <= d. Branch-free
+// with a fixed trip count so blocks of queries vectorize.
+inline int arcInterval(const float* s, float d) {
+    int lo = 0;
+    for (int step = arcSearchStep(ARC_INTERVALS); step > 0; step >>= 1) {
+        int probe = lo + step;
+        lo = (probe < ARC_INTERVALS && s[probe] <= d) ? probe : lo;
+    }
+    return lo;
+}
+
+// Initial guess for t from the Hermite model of s(t) on interval i: a linear
+// start refined by two Newton steps on the cubic.
+inline float arcGuess(const BZarcLength& a, int i, float d) {
+    const float h = 1.0f / ARC_INTERVALS;
+    float s0 = a.s[i], s1 = a.s[i + 1];
+    float m0 = a.v[i] * h, m1 = a.v[i + 1] * h;
+    float u = s1 > s0 ? (d - s0) / (s1 - s0) : 0.0f;
+    for (int it = 0; it < 2; ++it) {
+        float u2 = u * u, u3 = u2 * u;
+        float H = (2 * u3 - 3 * u2 + 1) * s0 + (u3 - 2 * u2 + u) * m0 + (-2 * u3 + 3 * u2) * s1 + (u3 - u2) * m1;
+        float dH = (6 * u2 - 6 * u) * s0 + (3 * u2 - 4 * u + 1) * m0 + (-6 * u2 + 6 * u) * s1 + (3 * u2 - 2 * u) * m1;
+        if (dH > 1e-12f) u -= (H - d) / dH;
+        u = std::min(std::max(u, 0.0f), 1.0f);
+    }
+    return arcNode(i) + u * h;
+}
+
+// Maps count distances (clamped to [0, total]) to parameters. The Newton
+// step needs the true length up to each guess and the speed there: six
+// derivative evaluations per query, done in one batch.
+inline void arcParamBatch(BZarcLength& a, const float* dist, int count, float* tOut) {
+    if (a.hodo.empty() || a.total <= 0) {
+        for (int j = 0; j < count; ++j)
+            tOut[j] = 0;
+        return;
+    }
+    const int K = GAUSS_N + 1;
+    if (a.qt.size() < size_t(count) * K) {
+        a.qt.resize(size_t(count) * K);
+        a.qd.resize(size_t(count) * K);
+    }
+    if (a.qi.size() < size_t(count))
+        a.qi.resize(count);
+
+    for (int j = 0; j < count; ++j) {
+        float d = std::min(std::max(dist[j], 0.0f), a.total);
+        int i = arcInterval(a.s.data(), d);
+        float t0 = arcGuess(a, i, d);
+        float ti = arcNode(i);
+        a.qi[j] = i;
+        for (int k = 0; k < GAUSS_N; ++k)
+            a.qt[size_t(j) * K + k] = float(ti + (GAUSS_X[k] + 1) * 0.5 * (t0 - ti));
+        a.qt[size_t(j) * K + GAUSS_N] = t0;
+    }
+    bezierBatchAuto(a.hodo.data(), int(a.hodo.size()), a.qt.data(), count * K, a.qd.data(), a.scratch);
+
+    for (int j = 0; j < count; ++j) {
+        float d = std::min(std::max(dist[j], 0.0f), a.total);
+        int i = a.qi[j];
+        float ti = arcNode(i);
+        float t0 = a.qt[size_t(j) * K + GAUSS_N];
+        double len = 0;
+        for (int k = 0; k < GAUSS_N; ++k)
+            len += GAUSS_W[k] * speedOf(a.qd[size_t(j) * K + k]);
+        float s0 = a.s[i] + float(len * 0.5 * (t0 - ti));
+        float v0 = speedOf(a.qd[size_t(j) * K + GAUSS_N]);
+        float t = v0 > 1e-12f ? t0 - (s0 - d) / v0 : t0;
+        tOut[j] = std::min(std::max(t, ti), arcNode(i + 1));
+    }
+}
+
+inline float arcParam(BZarcLength& a, float dist) {
+    float t;
+    arcParamBatch(a, &dist, 1, &t);
+    return t;
+}
@@ -0,0 +1,451 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <algorithm>
+#include "bezier.h"
+#include "ptgrid.h"
+#include "arclen.h"
+#include "curvepick.h"
+#include "bounds.h"
+#include "intersect.h"
+#include "tessbatch.h"
+#include "stroke.h"
+#include "fill.h"
+#include "raster.h"
+#include "font.h"
+#include "fitcurve.h"
+
+// Micro-benchmarks, run with --bench. Each prints one line per configuration.
+
+inline double benchNow() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline std::vector<BZpoint> benchRandomPoints(int n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(-1, 1);
+    std::vector<BZpoint> p(n);
+    for (BZpoint& q : p)
+        q = { u(rng), u(rng) };
+    return p;
+}
+
+// Control-point hit testing: linear scan with dist() vs. the hashed grid.
+inline void benchPick(int n, float radius) {
+    std::vector<BZpoint> p = benchRandomPoints(n, 1);
+    // Three quarters of the queries land outside the points and miss, like
+    // clicks that add a new point.
+    std::vector<BZpoint> q = benchRandomPoints(1000, 2);
+    for (BZpoint& m : q)
+        m = m.mult(2);
+
+    double t0 = benchNow();
+    BZgrid g;
+    gridBuild(g, p.data(), n, radius);
+    double build = benchNow() - t0;
+
+    long long linHits = 0, gridHits = 0;
+    t0 = benchNow();
+    for (BZpoint m : q)
+        for (int i = 0; i < n; ++i)
+            if (p[i].dist(m) < radius) {
+                linHits += i;
+                break;
+            }
+    double lin = benchNow() - t0;
+
+    t0 = benchNow();
+    for (BZpoint m : q) {
+        int i = gridPick(g, p.data(), m, radius);
+        if (i >= 0) gridHits += i;
+    }
+    double grid = benchNow() - t0;
+
+    printf("pick n=%d: linear %.2f us/query, grid %.3f us/query (build %.2f ms)%s\n",
+        n, lin * 1e6 / q.size(), grid * 1e6 / q.size(), build * 1e3,
+        linHits == gridHits ? "" : "  MISMATCH");
+}
+
+// Arc-length table build and distance -> t queries for random curves.
+inline void benchArcLength(int n, int queries) {
+    std::vector<BZpoint> p = benchRandomPoints(n, 3);
+    BZarcLength a;
+    const int builds = 1000;
+    double t0 = benchNow();
+    for (int r = 0; r < builds; ++r)
+        arcBuild(a, p.data(), n);
+    double build = benchNow() - t0;
+
+    std::vector<float> d(queries), t(queries);
+    for (int i = 0; i < queries; ++i)
+        d[i] = a.total * i / (queries - 1);
+    arcParamBatch(a, d.data(), queries, t.data());
+    const int reps = 20;
+    t0 = benchNow();
+    for (int r = 0; r < reps; ++r)
+        arcParamBatch(a, d.data(), queries, t.data());
+    double query = benchNow() - t0;
+
+    printf("arclen n=%d: build %.2f us, %d queries %.1f us (%.1f ns/query)\n",
+        n, build * 1e6 / builds, queries, query * 1e6 / reps, query * 1e9 / reps / queries);
+}
+
+// Closest point on curves: cubics of size ~0.1 scattered over the square,
+// 2^PICK_DEPTH pieces each. Checked against dense sampling of every curve.
+inline void benchCurvePick(int curves) {
+    std::vector<BZpoint> p = benchRandomPoints(curves * 4, 4);
+    for (int c = 0; c < curves; ++c)
+        for (int k = 1; k < 4; ++k)
+            p[c * 4 + k] = p[c * 4].add(p[c * 4 + k].mult(0.05f));
+    std::vector<BZpoint> q = benchRandomPoints(1000, 5);
+
+    double t0 = benchNow();
+    BZcurveIndex x;
+    for (int c = 0; c < curves; ++c)
+        pickAddCurve(x, &p[c * 4], 4);
+    pickBuild(x);
+    double build = benchNow() - t0;
+
+    std::vector<BZpickHit> hits(q.size());
+    t0 = benchNow();
+    for (size_t i = 0; i < q.size(); ++i)
+        pickClosest(x, q[i], 0.1f, hits[i]);
+    double query = benchNow() - t0;
+
+    // Brute force on the first queries only; it is slow.
+    int worse = 0;
+    BZscratch s;
+    for (size_t i = 0; i < 20; ++i) {
+        float best = 0.1f;
+        for (int c = 0; c < curves; ++c)
+            for (int k = 0; k <= 256; ++k)
+                best = std::min(best, bezierEval(k / 256.0f, &p[c * 4], 4, s.get(4)).dist(q[i]));
+        if (hits[i].dist > best + 1e-4f) ++worse;
+    }
+    printf("curve pick %d pieces: %.2f us/query (build %.2f ms)%s\n",
+        int(x.pieces.size()), query * 1e6 / q.size(), build * 1e3, worse ? "  MISMATCH" : "");
+}
+
+// Hull and exact boxes; how much smaller the exact box is on average.
+inline void benchBounds(int n, int curves) {
+    std::vector<BZpoint> p = benchRandomPoints(n * curves, 6);
+    BZscratch s;
+    double hullArea = 0, exactArea = 0;
+    double t0 = benchNow();
+    for (int c = 0; c < curves; ++c) {
+        BZbox b = hullBox(&p[size_t(c) * n], n);
+        hullArea += double(b.x1 - b.x0) * (b.y1 - b.y0);
+    }
+    double hull = benchNow() - t0;
+    t0 = benchNow();
+    for (int c = 0; c < curves; ++c) {
+        BZbox b = exactBox(&p[size_t(c) * n], n, s);
+        exactArea += double(b.x1 - b.x0) * (b.y1 - b.y0);
+    }
+    double exact = benchNow() - t0;
+    printf("bounds n=%d: hull %.1f ns, exact %.1f ns per curve, exact/hull area %.2f\n",
+        n, hull * 1e9 / curves, exact * 1e9 / curves, exactArea / hullArea);
+}
+
+// All-pairs intersection of random cubics of size ~0.3, 1 thread vs. all.
+inline void benchIntersect(int curves) {
+    std::vector<BZpoint> p = benchRandomPoints(curves * 4, 7);
+    BZdoc doc;
+    for (int c = 0; c < curves; ++c) {
+        for (int k = 1; k < 4; ++k)
+            p[c * 4 + k] = p[c * 4].add(p[c * 4 + k].mult(0.15f));
+        doc.addCurve(&p[c * 4], 4);
+    }
+    std::vector<BZxhit> one, all;
+    size_t pairs = 0;
+    double t0 = benchNow();
+    intersectAll(doc.view(), 1e-4f, 1, one, &pairs);
+    double single = benchNow() - t0;
+    t0 = benchNow();
+    intersectAll(doc.view(), 1e-4f, 0, all);
+    double multi = benchNow() - t0;
+    printf("intersect %d curves: %zu candidate pairs, %zu hits, 1 thread %.2f ms, %u threads %.2f ms%s\n",
+        curves, pairs, one.size(), single * 1e3, std::max(1u, std::thread::hardware_concurrency()), multi * 1e3,
+        one.size() == all.size() ? "" : "  MISMATCH");
+}
+
+// Generic de Casteljau vs. the degree-specialized evaluator, 1001 samples.
+inline void benchFixed(int degree) {
+    int n = degree + 1;
+    std::vector<BZpoint> p = benchRandomPoints(n, 8);
+    std::vector<float> ts(1001);
+    uniformParams(ts.data(), 1001);
+    std::vector<BZpoint> a(1001), b(1001);
+    BZscratch s;
+    const int reps = 2000;
+    double t0 = benchNow();
+    for (int r = 0; r < reps; ++r)
+        bezierBatch(p.data(), n, ts.data(), 1001, a.data(), s);
+    double generic = benchNow() - t0;
+    t0 = benchNow();
+    for (int r = 0; r < reps; ++r)
+        bezierBatchFast(p.data(), n, ts.data(), 1001, b.data(), s);
+    double fixed = benchNow() - t0;
+    float err = 0;
+    for (int j = 0; j < 1001; ++j)
+        err = std::max(err, a[j].dist(b[j]));
+    printf("eval degree %d: generic %.2f ns, specialized %.2f ns per point (max difference %.2g)\n",
+        degree, generic * 1e9 / reps / 1001, fixed * 1e9 / reps / 1001, err);
+}
+
+// O(n) Bernstein walk vs. SIMD de Casteljau by degree, 1001 samples, and
+// the largest error of each against de Casteljau in double.
+inline void benchHighDegree(int n) {
+    std::vector<BZpoint> p = benchRandomPoints(n, 9);
+    std::vector<float> ts(1001);
+    uniformParams(ts.data(), 1001);
+    std::vector<BZpoint> hi(1001), dc(1001);
+    BZscratch s;
+    double t0 = benchNow();
+    bezierBatchHigh(p.data(), n, ts.data(), 1001, hi.data());
+    double high = benchNow() - t0;
+    // Quadratic; skipped where it would take seconds.
+    bool simd = n <= 1024;
+    double simdSec = 0;
+    if (simd) {
+        t0 = benchNow();
+        bezierBatchSimd(p.data(), n, ts.data(), 1001, dc.data(), s);
+        simdSec = benchNow() - t0;
+    }
+    std::vector<double> x(n), y(n);
+    double errHigh = 0, errSimd = 0;
+    for (int j = 0; j < 1001; j += 10) {
+        double t = ts[j];
+        for (int i = 0; i < n; ++i) {
+            x[i] = p[i].x;
+            y[i] = p[i].y;
+        }
+        for (int k = 1; k < n; ++k)
+            for (int i = 0; i < n - k; ++i) {
+                x[i] = x[i] * (1 - t) + x[i + 1] * t;
+                y[i] = y[i] * (1 - t) + y[i + 1] * t;
+            }
+        errHigh = std::max(errHigh, std::hypot(x[0] - hi[j].x, y[0] - hi[j].y));
+        if (simd) errSimd = std::max(errSimd, std::hypot(x[0] - dc[j].x, y[0] - dc[j].y));
+    }
+    if (simd)
+        printf("degree %d: bernstein %.3f ms (error %.1e), simd de Casteljau %.3f ms (error %.1e)\n",
+            n - 1, high * 1e3, errHigh, simdSec * 1e3, errSimd);
+    else
+        printf("degree %d: bernstein %.3f ms (error %.1e)\n", n - 1, high * 1e3, errHigh);
+}
+
+// Batch tessellation of random cubics on 1..N pool threads. Efficiency is
+// T(1) / (k T(k)).
+inline void benchTessScaling(int curves) {
+    std::vector<BZpoint> p = benchRandomPoints(curves * 4, 10);
+    BZdoc doc;
+    for (int c = 0; c < curves; ++c) {
+        for (int k = 1; k < 4; ++k)
+            p[c * 4 + k] = p[c * 4].add(p[c * 4 + k].mult(0.3f));
+        doc.addCurve(&p[c * 4], 4);
+    }
+    std::vector<int> ids(curves);
+    for (int c = 0; c < curves; ++c)
+        ids[c] = c;
+    int maxThreads = std::max(1, int(std::thread::hardware_concurrency()));
+    std::vector<int> counts;
+    for (int k = 1; k < maxThreads; k *= 2)
+        counts.push_back(k);
+    counts.push_back(maxThreads);
+    double base = 0;
+    for (int k : counts) {
+        BZpool pool;
+        poolStart(pool, k);
+        BZtessBatch b;
+        tessBatch(pool, b, doc.view(), ids.data(), curves, 1e-4f);   // warm-up
+        const int reps = 5;
+        double t0 = benchNow();
+        for (int r = 0; r < reps; ++r)
+            tessBatch(pool, b, doc.view(), ids.data(), curves, 1e-4f);
+        double t = (benchNow() - t0) / reps;
+        if (k == 1) base = t;
+        printf("tessellate %d curves (%zu vertices), %d threads: %.2f ms, efficiency %.0f%%\n",
+            curves, b.verts.size(), k, t * 1e3, base / (k * t) * 100);
+    }
+}
+
+// A long wavy polyline, so every join turns a little.
+inline void benchStroke(int n) {
+    std::vector<BZpoint> p(n);
+    for (int i = 0; i < n; ++i)
+        p[i] = { i * 1e-3f, std::sin(i * 0.01f) };
+    BZstrokeScratch s;
+    for (int j = 0; j < 3; ++j) {
+        BZstrokeStyle st;
+        st.join = StrokeJoin(j);
+        st.cap = CAP_ROUND;
+        st.tol = 5e-4f;
+        std::vector<BZpoint> out(strokeMaxVerts(n, st));
+        int verts = strokePolyline(p.data(), n, st, out.data(), s);   // warm-up
+        const int reps = 5;
+        double t0 = benchNow();
+        for (int r = 0; r < reps; ++r)
+            strokePolyline(p.data(), n, st, out.data(), s);
+        double t = (benchNow() - t0) / reps;
+        printf("stroke %d segments, %s joins: %.2f ms, %d vertices, %.1f M segments/s\n",
+            n - 1, JOIN_NAMES[j], t * 1e3, verts, (n - 1) / t * 1e-6);
+    }
+}
+
+// A wavy star, so every horizontal line crosses many edges, then one point
+// dragged at a time.
+// Fill of a 37-lobe star, or of a comb whose closing edge runs back under
+// all the teeth, so that it crosses every one of them.
+inline void benchFill(int n, bool comb) {
+    std::vector<BZpoint> p(n);
+    if (comb) {
+        n -= n % 4;
+        float w = 1.8f / (n / 4);
+        for (int t = 0; t < n / 4; ++t) {
+            float x = -0.9f + t * w;
+            p[4 * t] = { x, 0.9f };
+            p[4 * t + 1] = { x, -0.9f };
+            p[4 * t + 2] = { x + w / 2, -0.9f };
+            p[4 * t + 3] = { x + w / 2, 0.7f };
+        }
+    }
+    else
+        for (int i = 0; i < n; ++i) {
+            float a = 6.2831853f * i / n, r = 0.6f + 0.3f * std::sin(a * 37);
+            p[i] = { r * std::cos(a), r * std::sin(a) };
+        }
+    BZfill f;
+    for (int rule = 0; rule < 2; ++rule) {
+        double t0 = benchNow();
+        int verts = fillBuild(f, p.data(), &n, 1, FillRule(rule));
+        double full = benchNow() - t0;
+        const int drags = 1000;
+        double total = 0, worst = 0;
+        for (int k = 0; k < drags; ++k) {
+            // Each point is moved out and back, so the shape does not drift.
+            int i = int((k / 2 * 7919LL) % n);
+            p[i].x += k & 1 ? 0.002f : -0.002f;
+            t0 = benchNow();
+            verts = fillUpdate(f, p.data(), i, i);
+            double t = benchNow() - t0;
+            total += t;
+            worst = std::max(worst, t);
+        }
+        printf("fill %s %d vertices, %s: build %.3f ms, one point moved %.3f ms (worst %.3f), %d triangles\n",
+            comb ? "comb" : "star", n, FILL_RULE_NAMES[rule], full * 1e3, total / drags * 1e3, worst * 1e3, verts / 3);
+    }
+}
+
+// Renders a document of random curves at a few sizes on every core.
+inline void benchRaster(int curves) {
+    std::vector<BZpoint> p = benchRandomPoints(curves * 4, 11);
+    BZdoc doc;
+    for (int c = 0; c < curves; ++c) {
+        for (int k = 1; k < 4; ++k)
+            p[c * 4 + k] = p[c * 4].add(p[c * 4 + k].mult(0.1f));
+        doc.addCurve(&p[c * 4], 4);
+    }
+    BZpool pool;
+    poolStart(pool, 0);
+    BZrenderOptions o;
+    o.fill = true;
+    for (int size : { 512, 1024, 4096 }) {
+        o.size = size;
+        BZimage img;
+        const int reps = 3;
+        double t0 = benchNow();
+        for (int r = 0; r < reps; ++r)
+            renderDocument(pool, doc.view(), o, img);
+        double t = (benchNow() - t0) / reps;
+        printf("render %d curves at %dx%d, %d threads: %.2f ms, %.0f Mpixels/s\n",
+            curves, img.w, img.h, poolSize(pool), t * 1e3, double(img.w) * img.h / t * 1e-6);
+    }
+}
+
+// Cost of an atlas miss: outline, tessellation and rasterization of every
+// glyph of the default font at a few sizes.
+inline void benchGlyphs() {
+    BZfont f;
+    std::string err;
+    if (!fontLoadDefault(f, err)) {
+        printf("glyphs: %s, skipped\n", err.c_str());
+        return;
+    }
+    BZglyphScratch gs;
+    BZglyphBitmap b;
+    for (int px : { 12, 32, 96 }) {
+        long long covered = 0;
+        double t0 = benchNow();
+        for (int g = 0; g < f.glyphCount; ++g) {
+            glyphRasterize(f, g, float(px), b, gs);
+            covered += (long long)b.w * b.h;
+        }
+        double t = benchNow() - t0;
+        printf("glyphs %d at %d px: %.2f us/glyph, %.1f pixels/glyph\n",
+            f.glyphCount, px, t * 1e6 / std::max(f.glyphCount, 1), double(covered) / std::max(f.glyphCount, 1));
+    }
+}
+
+// Freehand fitting of a wandering pen stroke: n samples a third of a
+// pixel apart in the editor's window, rounded to whole pixels like cursor
+// positions.
+inline void benchFit(int n) {
+    const float px = 2.0f / 800;
+    std::vector<BZpoint> p(n);
+    float a = 0, turn = 0;
+    BZpoint at = { 0, 0 };
+    std::mt19937 rng(12);
+    std::uniform_real_distribution<float> jitter(-0.02f, 0.02f);
+    for (int i = 0; i < n; ++i) {
+        turn = std::min(std::max(turn + jitter(rng), -0.05f), 0.05f);
+        a += turn;
+        at = at.add(BZpoint{ std::cos(a), std::sin(a) }.mult(px / 3));
+        p[i] = { std::round(at.x / px) * px, std::round(at.y / px) * px };
+    }
+    for (float tolPx : { 0.5f, 1.0f, 2.0f }) {
+        BZfitter f;
+        f.tol = tolPx * px;
+        double t0 = benchNow();
+        fitBegin(f, p[0]);
+        for (int i = 1; i < n; ++i)
+            fitAdd(f, p[i]);
+        fitEnd(f);
+        double t = benchNow() - t0;
+        int cubics = (int(f.segs.size()) - 1) / 3, smooth = 0;
+        for (int c = 1; c < cubics; ++c) {
+            BZpoint in = f.segs[3 * c].add(f.segs[3 * c - 1].mult(-1)), out = f.segs[3 * c + 1].add(f.segs[3 * c].mult(-1));
+            if (std::fabs(in.x - out.x) + std::fabs(in.y - out.y) <= 1e-3f * (std::fabs(in.x) + std::fabs(in.y))) ++smooth;
+        }
+        printf("fit %d samples, tol %g px: %d cubics, %d/%d joins C1, %.1fx fewer points, %.3f us/sample, longest run %d\n",
+            n, tolPx, cubics, smooth, std::max(cubics - 1, 0), double(n) / f.segs.size(), t * 1e6 / n, f.longestRun);
+    }
+}
+
+inline void runBenchmarks() {
+    for (int n : { 1000, 10000, 100000, 1000000 })
+        benchPick(n, 0.05f);
+    for (int n : { 4, 8, 16 })
+        benchArcLength(n, 1000);
+    for (int n : { 125, 1250, 12500 })
+        benchCurvePick(n);
+    for (int n : { 3, 4, 8, 16 })
+        benchBounds(n, 100000);
+    for (int n : { 1000, 10000 })
+        benchIntersect(n);
+    for (int d = 1; d <= 4; ++d)
+        benchFixed(d);
+    for (int n : { 32, 128, 512, 1024, 4096 })
+        benchHighDegree(n);
+    benchTessScaling(20000);
+    benchStroke(1000000);
+    for (int n : { 1000, 10000, 100000 }) {
+        benchFill(n, false);
+        benchFill(n, true);
+    }
+    benchRaster(2000);
+    benchGlyphs();
+    benchFit(100000);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cmath>
+#include "bezier.h"
+
+// O(n) evaluation for curves of very high degree, where de Casteljau's
+// O(n^2) per sample dominates.
+//
+// B(t) = sum_i w_i p_i with Bernstein weights w_i = C(d, i) t^i (1-t)^(d-i),
+// d = n - 1. The weights are a binomial distribution in i and sum to 1, so
+// they are only needed up to a common factor: the largest one, at
+// i = round(d t), is taken as 1 and the others follow from
+// w_i / w_(i-1) = (d - i + 1) / i * t / (1 - t), walking out in both
+// directions, and the sum is divided by the sum of the weights. Every
+// scaled weight is at most 1, so nothing overflows or underflows
+// prematurely whatever the degree, and the walk stops once the weights drop
+// below HIGH_CUTOFF, which leaves O(sqrt(n)) terms for mid-range t.
+// Accumulated in double.
+
+const double HIGH_CUTOFF = 1e-18;
+
+// Degree at which the O(n) path overtakes the SIMD de Casteljau kernels.
+const int HIGH_MIN_POINTS = 32;
+
+inline BZpoint bezierEvalHigh(float t, const BZpoint* p, int n) {
+    if (n <= 0) return { 0, 0 };
+    if (t <= 0 || n == 1) return p[0];
+    if (t >= 1) return p[n - 1];
+    int d = n - 1;
+    double tt = t, u = 1.0 - tt;
+    int k = int(std::floor(d * tt + 0.5));
+    double sx = p[k].x, sy = p[k].y, sw = 1;
+
+    double ratio = tt / u, w = 1;
+    for (int i = k + 1; i <= d && w > HIGH_CUTOFF; ++i) {
+        w *= double(d - i + 1) / i * ratio;
+        sx += w * p[i].x;
+        sy += w * p[i].y;
+        sw += w;
+    }
+    ratio = u / tt;
+    w = 1;
+    for (int i = k - 1; i >= 0 && w > HIGH_CUTOFF; --i) {
+        w *= double(i + 1) / (d - i) * ratio;
+        sx += w * p[i].x;
+        sy += w * p[i].y;
+        sw += w;
+    }
+    return { float(sx / sw), float(sy / sw) };
+}
+
+inline void bezierBatchHigh(const BZpoint* p, int n, const float* ts, int count, BZpoint* out) {
+    for (int j = 0; j < count; ++j)
+        out[j] = bezierEvalHigh(ts[j], p, n);
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+struct BZpoint {
+    float x, y;
+    BZpoint mult(float s) const { return { x * s, y * s }; }
+    BZpoint add(BZpoint p) const { return { x + p.x, y + p.y }; }
+    float dist(BZpoint p) const {
+        return std::sqrt((x - p.x) * (x - p.x) + (y - p.y) * (y - p.y));
+    }
+};
+
+// Working storage for the batch evaluators. It only ever grows, so once it has
+// seen the largest control polygon no further heap allocations happen.
+struct BZscratch {
+    std::vector<BZpoint> tmp;
+    std::vector<float> lanes;
+
+    BZpoint* get(size_t n) {
+        if (tmp.size() < n) tmp.resize(n);
+        return tmp.data();
+    }
+
+    float* getf(size_t n) {
+        if (lanes.size() < n) lanes.resize(n);
+        return lanes.data();
+    }
+};
+
+// de Casteljau for one t; tmp must hold n points.
+inline BZpoint bezierEval(float t, const BZpoint* p, int n, BZpoint* tmp) {
+    for (int i = 0; i < n; ++i)
+        tmp[i] = p[i];
+    for (int k = 1; k < n; ++k)
+        for (int i = 0; i < n - k; ++i)
+            tmp[i] = tmp[i].mult(1 - t).add(tmp[i + 1].mult(t));
+    return tmp[0];
+}
+
+// Evaluates the curve at ts[0..count) into out[0..count).
+inline void bezierBatch(const BZpoint* p, int n, const float* ts, int count,
+                        BZpoint* out, BZscratch& s) {
+    if (n <= 0) return;
+    BZpoint* tmp = s.get(n);
+    for (int j = 0; j < count; ++j)
+        out[j] = bezierEval(ts[j], p, n, tmp);
+}
+
+constexpr long long binomial(int n, int k) {
+    long long r = 1;
+    for (int i = 1; i <= k; ++i)
+        r = r * (n - k + i) / i;
+    return r;
+}
+
+// C(D, i) for i <= D, built at compile time.
+template <int D>
+struct BZbinomials {
+    float c[D + 1];
+    constexpr BZbinomials() : c() {
+        for (int i = 0; i <= D; ++i)
+            c[i] = float(binomial(D, i));
+    }
+};
+
+// Calls f(I), f(I + 1), ..., f(N - 1), expanded at compile time.
+template <int I, int N>
+struct BZunroll {
+    template <class F>
+    static void run(F& f) {
+        f(I);
+        BZunroll<I + 1, N>::run(f);
+    }
+};
+
+template <int N>
+struct BZunroll<N, N> {
+    template <class F>
+    static void run(F&) {}
+};
+
+// Bernstein form for a fixed degree D (D + 1 points), fully unrolled.
+template <int D>
+inline BZpoint bezierFixed(float t, const std::array<BZpoint, D + 1>& p) {
+    static_assert(D >= 0, "a curve needs a point");
+    constexpr BZbinomials<D> C{};
+    float u = 1 - t;
+    float tp[D + 1], up[D + 1];
+    tp[0] = up[0] = 1;
+    auto powers = [&](int i) {
+        tp[i] = tp[i - 1] * t;
+        up[i] = up[i - 1] * u;
+    };
+    BZunroll<1, D + 1>::run(powers);
+    BZpoint r = { 0, 0 };
+    auto term = [&](int i) {
+        float w = C.c[i] * tp[i] * up[D - i];
+        r.x += w * p[i].x;
+        r.y += w * p[i].y;
+    };
+    BZunroll<0, D + 1>::run(term);
+    return r;
+}
+
+template <int D>
+inline std::array<BZpoint, D + 1> fixedPoints(const BZpoint* p) {
+    std::array<BZpoint, D + 1> a;
+    std::copy(p, p + D + 1, a.begin());
+    return a;
+}
+
+template <int D>
+inline void bezierBatchFixed(const BZpoint* p, const float* ts, int count, BZpoint* out) {
+    std::array<BZpoint, D + 1> a = fixedPoints<D>(p);
+    for (int j = 0; j < count; ++j)
+        out[j] = bezierFixed<D>(ts[j], a);
+}
+
+// Degrees 1 to 4 take the specialized evaluator; anything else the
+// de Casteljau loop. tmp must hold n points.
+inline BZpoint bezierEvalFast(float t, const BZpoint* p, int n, BZpoint* tmp) {
+    switch (n - 1) {
+    case 1: return bezierFixed<1>(t, fixedPoints<1>(p));
+    case 2: return bezierFixed<2>(t, fixedPoints<2>(p));
+    case 3: return bezierFixed<3>(t, fixedPoints<3>(p));
+    case 4: return bezierFixed<4>(t, fixedPoints<4>(p));
+    default: return bezierEval(t, p, n, tmp);
+    }
+}
+
+inline void bezierBatchFast(const BZpoint* p, int n, const float* ts, int count,
+                            BZpoint* out, BZscratch& s) {
+    switch (n - 1) {
+    case 1: bezierBatchFixed<1>(p, ts, count, out); break;
+    case 2: bezierBatchFixed<2>(p, ts, count, out); break;
+    case 3: bezierBatchFixed<3>(p, ts, count, out); break;
+    case 4: bezierBatchFixed<4>(p, ts, count, out); break;
+    default: bezierBatch(p, n, ts, count, out, s); break;
+    }
+}
+
+// Derivative of the n-point curve p: n - 1 points.
+inline void hodograph(const BZpoint* p, int n, BZpoint* q) {
+    for (int i = 0; i + 1 < n; ++i)
+        q[i] = p[i + 1].add(p[i].mult(-1)).mult(float(n - 1));
+}
+
+// Fills ts with count uniformly spaced parameters covering [0, 1].
+inline void uniformParams(float* ts, int count) {
+    for (int j = 0; j < count; ++j)
+        ts[j] = count > 1 ? float(j) / float(count - 1) : 0.0f;
+}
+
+inline BZpoint bezier(float t, const std::vector<BZpoint>& p) {
+    thread_local BZscratch s;
+    return bezierEvalFast(t, p.data(), int(p.size()), s.get(p.size()));
+}
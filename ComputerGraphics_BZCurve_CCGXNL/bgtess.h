@@ -0,0 +1,166 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "bezier.h"
+#include "tessellate.h"
+
+// Tessellation of the edited curve on a background thread, so heavy curves
+// don't stall input handling. The render thread submits the control points
+// and keeps drawing the last complete polyline; the worker tessellates into
+// its own buffer and swaps it with the ready buffer when done. A newer
+// submission cancels the job in flight: the worker checks between chunks of
+// BG_CHUNK samples and drops the stale result. So that a drag over a curve
+// slower than a frame still updates, a stale job is only dropped if the
+// last result went out less than BG_STARVE_MS ago.
+//
+// No GL here; the render thread uploads what bgFetch() hands it.
+
+const int BG_CHUNK = 64;
+const double BG_STARVE_MS = 50;
+
+struct BZbgJob {
+    std::vector<BZpoint> pts;
+    bool adaptive = false;
+    float tol = 0;
+    int samples = 0;    // uniform vertex count
+    int capacity = 0;   // adaptive vertex limit
+    long long id = 0;
+};
+
+struct BZbgResult {
+    std::vector<BZpoint> verts;
+    int count = 0;
+    double ms = 0;
+    float maxDrift = 0;
+    int fallbacks = 0;
+    long long id = 0;
+};
+
+struct BZbgTess {
+    std::thread thread;
+    std::mutex m;
+    std::condition_variable wake;
+    BZbgJob pending;
+    bool hasPending = false;
+    bool quit = false;
+    std::atomic<long long> latest{ 0 };
+    long long cancelled = 0;
+
+    // Worker side: work is private to the worker, ready is handed over.
+    BZbgJob job;
+    BZbgResult work, ready;
+    bool hasReady = false;
+    std::vector<float> ts;
+    BZscratch scratch;
+    BZfwdDiff fd;
+    std::chrono::steady_clock::time_point delivered;
+
+    ~BZbgTess();
+};
+
+inline bool bgStale(const BZbgTess& bg, long long id) {
+    if (bg.latest.load() == id) return false;
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bg.delivered).count() < BG_STARVE_MS;
+}
+
+// Tessellates bg.job into bg.work; false if a newer job arrived meanwhile.
+inline bool bgRun(BZbgTess& bg) {
+    const BZbgJob& j = bg.job;
+    BZbgResult& r = bg.work;
+    const BZpoint* p = j.pts.data();
+    int n = int(j.pts.size());
+    auto t0 = std::chrono::steady_clock::now();
+    bg.fd.resetStats();
+    if (j.adaptive) {
+        r.verts.resize(j.capacity);
+        r.count = bezierAdaptive(p, n, j.tol, r.verts.data(), j.capacity, bg.scratch);
+    }
+    else {
+        r.verts.resize(j.samples);
+        r.count = j.samples;
+        if (int(bg.ts.size()) != j.samples) {
+            bg.ts.resize(j.samples);
+            uniformParams(bg.ts.data(), j.samples);
+        }
+        // Low degrees finish in microseconds; only the slow paths are chunked.
+        if (n - 1 <= FD_MAX_DEGREE)
+            tessUniform(p, n, bg.ts.data(), j.samples, r.verts.data(), bg.fd, bg.scratch);
+        else
+            for (int k = 0; k < j.samples; k += BG_CHUNK) {
+                if (bgStale(bg, j.id)) return false;
+                int c = std::min(BG_CHUNK, j.samples - k);
+                bezierBatchAuto(p, n, bg.ts.data() + k, c, r.verts.data() + k, bg.scratch);
+            }
+    }
+    r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    r.maxDrift = bg.fd.maxDrift;
+    r.fallbacks = bg.fd.fallbacks;
+    r.id = j.id;
+    return !bgStale(bg, j.id);
+}
+
+inline void bgWorker(BZbgTess& bg) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(bg.m);
+            bg.wake.wait(lk, [&] { return bg.quit || bg.hasPending; });
+            if (bg.quit) return;
+            std::swap(bg.job, bg.pending);
+            bg.hasPending = false;
+        }
+        bool done = bgRun(bg);
+        std::lock_guard<std::mutex> lk(bg.m);
+        if (!done) {
+            ++bg.cancelled;
+            continue;
+        }
+        std::swap(bg.work, bg.ready);
+        bg.hasReady = true;
+        bg.delivered = std::chrono::steady_clock::now();
+    }
+}
+
+inline void bgStart(BZbgTess& bg) {
+    if (!bg.thread.joinable())
+        bg.thread = std::thread(bgWorker, std::ref(bg));
+}
+
+inline BZbgTess::~BZbgTess() {
+    {
+        std::lock_guard<std::mutex> lk(m);
+        quit = true;
+    }
+    wake.notify_all();
+    if (thread.joinable())
+        thread.join();
+}
+
+// Queues a tessellation of p, replacing any queued job and cancelling the
+// one in flight.
+inline void bgSubmit(BZbgTess& bg, const BZpoint* p, int n, bool adaptive, float tol, int samples, int capacity) {
+    std::lock_guard<std::mutex> lk(bg.m);
+    if (bg.hasPending) ++bg.cancelled;
+    bg.pending.pts.assign(p, p + n);
+    bg.pending.adaptive = adaptive;
+    bg.pending.tol = tol;
+    bg.pending.samples = samples;
+    bg.pending.capacity = capacity;
+    bg.pending.id = bg.latest.load() + 1;
+    bg.latest = bg.pending.id;
+    bg.hasPending = true;
+    bg.wake.notify_one();
+}
+
+// Swaps the newest finished result into front; false if there is none.
+inline bool bgFetch(BZbgTess& bg, BZbgResult& front) {
+    std::lock_guard<std::mutex> lk(bg.m);
+    if (!bg.hasReady) return false;
+    std::swap(bg.ready, front);
+    bg.hasReady = false;
+    return true;
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include "bezier.h"
+
+// Axis-aligned bounds of Bezier curves.
+//
+// hullBox: box of the control points. The curve lies in their convex hull,
+//   so this always contains it; one pass, no evaluation.
+// exactBox: box of the end points and of the curve at every root of P'(t)
+//   in (0, 1), found per axis. Tight up to float rounding.
+
+struct BZbox {
+    float x0 = FLT_MAX, y0 = FLT_MAX, x1 = -FLT_MAX, y1 = -FLT_MAX;
+
+    void grow(BZpoint p) {
+        x0 = std::min(x0, p.x);
+        y0 = std::min(y0, p.y);
+        x1 = std::max(x1, p.x);
+        y1 = std::max(y1, p.y);
+    }
+    void grow(const BZbox& b) {
+        x0 = std::min(x0, b.x0);
+        y0 = std::min(y0, b.y0);
+        x1 = std::max(x1, b.x1);
+        y1 = std::max(y1, b.y1);
+    }
+    bool overlaps(const BZbox& b) const {
+        return x0 <= b.x1 && b.x0 <= x1 && y0 <= b.y1 && b.y0 <= y1;
+    }
+    // Squared distance from q, 0 inside.
+    float dist2(BZpoint q) const {
+        float dx = std::max(std::max(x0 - q.x, q.x - x1), 0.0f);
+        float dy = std::max(std::max(y0 - q.y, q.y - y1), 0.0f);
+        return dx * dx + dy * dy;
+    }
+};
+
+// Root isolation stops at parameter intervals this small. P' vanishes at the
+// extremum, so the error in the box is quadratic in it.
+const float BOUND_T_TOL = 1e-4f;
+const int BOUND_MAX_DEPTH = 16;
+// Degree of P' above which roots are isolated by subdivision.
+const int BOUND_CLOSED_FORM = 2;
+
+inline BZbox hullBox(const BZpoint* p, int n) {
+    BZbox b;
+    for (int i = 0; i < n; ++i)
+        b.grow(p[i]);
+    return b;
+}
+
+inline int signChanges(const float* c, int m) {
+    int changes = 0, last = 0;
+    for (int i = 0; i < m; ++i) {
+        int s = c[i] > 0 ? 1 : (c[i] < 0 ? -1 : 0);
+        if (s && last && s != last) ++changes;
+        if (s) last = s;
+    }
+    return changes;
+}
+
+// 1-D Bernstein polynomial c[0..m) at local parameter u; tmp holds m floats.
+inline float bernsteinEval(const float* c, int m, float u, float* tmp) {
+    for (int i = 0; i < m; ++i)
+        tmp[i] = c[i];
+    for (int k = 1; k < m; ++k)
+        for (int i = 0; i < m - k; ++i)
+            tmp[i] = tmp[i] * (1 - u) + tmp[i + 1] * u;
+    return tmp[0];
+}
+
+// Roots in (t0, t1) of the 1-D Bernstein polynomial c[0..m), by halving
+// while its coefficients change sign (they change sign at least as often as
+// the polynomial does). An interval with one sign change and opposite end
+// values holds exactly one root, found by the Illinois method instead.
+// work holds 2 * m * (BOUND_MAX_DEPTH + 1) floats.
+inline void bernsteinRoots(const float* c, int m, float t0, float t1, int depth,
+                           float* work, float* roots, int& count, int cap) {
+    if (count >= cap) return;
+    int changes = signChanges(c, m);
+    if (changes == 0) return;
+    if (changes == 1 && (c[0] > 0) != (c[m - 1] > 0) && c[0] != 0 && c[m - 1] != 0) {
+        float a = 0, b = 1, fa = c[0], fb = c[m - 1], u = 0.5f;
+        int side = 0;
+        for (int it = 0; it < 64 && (b - a) * (t1 - t0) >= BOUND_T_TOL; ++it) {
+            float prev = u;
+            u = (a * fb - b * fa) / (fb - fa);
+            float fu = bernsteinEval(c, m, u, work);
+            if (fu == 0 || std::fabs(u - prev) * (t1 - t0) < BOUND_T_TOL * 0.01f) {
+                a = b = u;
+                break;
+            }
+            if ((fu > 0) == (fa > 0)) {
+                a = u;
+                fa = fu;
+                if (side == -1) fb *= 0.5f;
+                side = -1;
+            }
+            else {
+                b = u;
+                fb = fu;
+                if (side == 1) fa *= 0.5f;
+                side = 1;
+            }
+        }
+        roots[count++] = t0 + (t1 - t0) * (a + b) * 0.5f;
+        return;
+    }
+    if (t1 - t0 < BOUND_T_TOL || depth >= BOUND_MAX_DEPTH) {
+        float a = c[0], b = c[m - 1];
+        roots[count++] = (a > 0) != (b > 0) && a != b ? t0 + (t1 - t0) * a / (a - b) : (t0 + t1) * 0.5f;
+        return;
+    }
+    float* left = work;
+    float* right = work + m;
+    float* next = right + m;
+    // de Casteljau at 1/2 in place in right; each step finalizes one entry
+    // at its back and one of left.
+    for (int i = 0; i < m; ++i)
+        right[i] = c[i];
+    left[0] = c[0];
+    for (int k = 1; k < m; ++k) {
+        for (int i = 0; i < m - k; ++i)
+            right[i] = (right[i] + right[i + 1]) * 0.5f;
+        left[k] = right[0];
+    }
+    float tm = (t0 + t1) * 0.5f;
+    bernsteinRoots(left, m, t0, tm, depth + 1, next, roots, count, cap);
+    bernsteinRoots(right, m, tm, t1, depth + 1, next, roots, count, cap);
+}
+
+// Roots in (0, 1) of a(1-t)^2 + 2b t(1-t) + c t^2.
+inline int quadraticRoots(float a, float b, float c, float* roots) {
+    double A = double(a) - 2.0 * b + c, B = 2.0 * (double(b) - a), C = a;
+    int count = 0;
+    auto keep = [&](double t) {
+        if (t > 0 && t < 1) roots[count++] = float(t);
+    };
+    if (std::fabs(A) < 1e-12) {
+        if (B != 0) keep(-C / B);
+        return count;
+    }
+    double disc = B * B - 4 * A * C;
+    if (disc < 0) return 0;
+    double q = -0.5 * (B + (B < 0 ? -std::sqrt(disc) : std::sqrt(disc)));
+    keep(q / A);
+    if (q != 0) keep(C / q);
+    return count;
+}
+
+inline BZbox exactBox(const BZpoint* p, int n, BZscratch& s) {
+    BZbox b;
+    if (n <= 0) return b;
+    b.grow(p[0]);
+    b.grow(p[n - 1]);
+    int m = n - 1;   // coefficients of P'
+    if (m < 2) return b;
+    float* d = s.getf(size_t(m) * (2 * BOUND_MAX_DEPTH + 3) + 2 * size_t(n));
+    float* roots = d + m;
+    float* work = roots + 2 * n;
+    BZpoint* tmp = s.get(n);
+    for (int axis = 0; axis < 2; ++axis) {
+        // Axis already inside the box at the ends: nothing can stick out.
+        float lo = axis ? b.y0 : b.x0, hi = axis ? b.y1 : b.x1;
+        bool inside = true;
+        for (int i = 1; i < n - 1 && inside; ++i) {
+            float v = axis ? p[i].y : p[i].x;
+            inside = v >= lo && v <= hi;
+        }
+        if (inside) continue;
+        for (int i = 0; i < m; ++i)
+            d[i] = axis ? p[i + 1].y - p[i].y : p[i + 1].x - p[i].x;
+        int count = 0;
+        if (m - 1 <= BOUND_CLOSED_FORM)
+            count = m == 3 ? quadraticRoots(d[0], d[1], d[2], roots)
+                           : quadraticRoots(d[0], (d[0] + d[1]) * 0.5f, d[1], roots);
+        else
+            bernsteinRoots(d, m, 0, 1, 0, work, roots, count, 2 * n);
+        for (int r = 0; r < count; ++r)
+            b.grow(bezierEval(roots[r], p, n, tmp));
+    }
+    return b;
+}
@@ -0,0 +1,323 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "bezier.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Curve document file (.bzc), version 1. All fields little-endian.
+//
+//   BZfileHeader                      32 bytes
+//   BZcurveRec[curveCount]            16 bytes each
+//   padding to a 16-byte boundary
+//   BZpoint[pointCount]               float x, y; at pointOffset
+//
+// Curve c uses points [first, first + count). The point array has exactly the
+// in-memory BZpoint layout, so a mapped file is evaluated in place.
+
+const uint32_t BZFILE_VERSION = 1;
+const char BZFILE_MAGIC[4] = { 'B', 'Z', 'C', 'V' };
+
+struct BZfileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t curveCount;
+    uint32_t reserved;
+    uint64_t pointCount;
+    uint64_t pointOffset;
+};
+
+struct BZcurveRec {
+    uint64_t first;
+    uint64_t count;
+};
+
+static_assert(sizeof(BZfileHeader) == 32, "BZfileHeader layout");
+static_assert(sizeof(BZcurveRec) == 16, "BZcurveRec layout");
+static_assert(sizeof(BZpoint) == 8, "BZpoint layout");
+
+// Read-only view of a document, either mapped or backed by a BZdoc.
+struct BZdocView {
+    const BZcurveRec* curves = nullptr;
+    const BZpoint* pts = nullptr;
+    uint32_t curveCount = 0;
+    uint64_t pointCount = 0;
+};
+
+// In-memory document, used by the text path and for building new files.
+struct BZdoc {
+    std::vector<BZcurveRec> curves;
+    std::vector<BZpoint> pts;
+
+    void addCurve(const BZpoint* p, size_t n) {
+        curves.push_back({ pts.size(), n });
+        pts.insert(pts.end(), p, p + n);
+    }
+
+    BZdocView view() const {
+        return { curves.data(), pts.data(), uint32_t(curves.size()), pts.size() };
+    }
+};
+
+inline uint64_t bzPointOffset(uint32_t curveCount) {
+    uint64_t off = sizeof(BZfileHeader) + uint64_t(curveCount) * sizeof(BZcurveRec);
+    return (off + 15) & ~uint64_t(15);
+}
+
+inline bool bzLittleEndian() {
+    const uint16_t one = 1;
+    return *(const uint8_t*)&one == 1;
+}
+
+// Memory-mapped file (read-only).
+struct BZmapped {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+inline void bzUnmap(BZmapped& m) {
+#ifdef _WIN32
+    if (m.data) UnmapViewOfFile(m.data);
+    if (m.mapping) CloseHandle(m.mapping);
+    if (m.file != INVALID_HANDLE_VALUE) CloseHandle(m.file);
+    m.file = INVALID_HANDLE_VALUE;
+    m.mapping = nullptr;
+#else
+    if (m.data) munmap((void*)m.data, m.size);
+    if (m.fd >= 0) close(m.fd);
+    m.fd = -1;
+#endif
+    m.data = nullptr;
+    m.size = 0;
+}
+
+inline bool bzMap(const char* path, BZmapped& m) {
+#ifdef _WIN32
+    m.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m.file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(m.file, &sz) || sz.QuadPart == 0) {
+        bzUnmap(m);
+        return false;
+    }
+    m.size = size_t(sz.QuadPart);
+    m.mapping = CreateFileMappingA(m.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m.mapping)
+        m.data = (const uint8_t*)MapViewOfFile(m.mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    m.fd = open(path, O_RDONLY);
+    if (m.fd < 0) return false;
+    struct stat st;
+    if (fstat(m.fd, &st) != 0 || st.st_size == 0) {
+        bzUnmap(m);
+        return false;
+    }
+    m.size = size_t(st.st_size);
+    void* p = mmap(nullptr, m.size, PROT_READ, MAP_SHARED, m.fd, 0);
+    m.data = p == MAP_FAILED ? nullptr : (const uint8_t*)p;
+#endif
+    if (!m.data) {
+        bzUnmap(m);
+        return false;
+    }
+    return true;
+}
+
+// Validates a mapped document and points view into it.
+inline bool bzViewMapped(const BZmapped& m, BZdocView& view, std::string& err) {
+    if (!bzLittleEndian()) { err = "big-endian hosts are not supported"; return false; }
+    if (m.size < sizeof(BZfileHeader)) { err = "file too small"; return false; }
+    BZfileHeader h;
+    memcpy(&h, m.data, sizeof(h));
+    if (memcmp(h.magic, BZFILE_MAGIC, 4) != 0) { err = "not a curve document"; return false; }
+    if (h.version != BZFILE_VERSION) { err = "unsupported version " + std::to_string(h.version); return false; }
+    if (h.pointOffset != bzPointOffset(h.curveCount) || h.pointOffset > m.size ||
+        h.pointCount > (m.size - std::min<uint64_t>(m.size, h.pointOffset)) / sizeof(BZpoint)) {
+        err = "truncated or corrupt file";
+        return false;
+    }
+    view.curves = (const BZcurveRec*)(m.data + sizeof(BZfileHeader));
+    view.pts = (const BZpoint*)(m.data + h.pointOffset);
+    view.curveCount = h.curveCount;
+    view.pointCount = h.pointCount;
+    for (uint32_t c = 0; c < h.curveCount; ++c) {
+        const BZcurveRec& r = view.curves[c];
+        if (r.first > h.pointCount || r.count > h.pointCount - r.first) {
+            err = "curve " + std::to_string(c) + " out of range";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes a complete document; curve c is the counts[c] points at curvePts[c].
+inline bool bzSaveFile(const char* path, const BZpoint* const* curvePts, const uint64_t* counts,
+                       uint32_t curveCount, std::string& err) {
+    if (!bzLittleEndian()) { err = "big-endian hosts are not supported"; return false; }
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f) { err = std::string("cannot create ") + path; return false; }
+    BZfileHeader h;
+    memcpy(h.magic, BZFILE_MAGIC, 4);
+    h.version = BZFILE_VERSION;
+    h.curveCount = curveCount;
+    h.reserved = 0;
+    h.pointCount = 0;
+    h.pointOffset = bzPointOffset(curveCount);
+    std::vector<BZcurveRec> recs(curveCount);
+    for (uint32_t c = 0; c < curveCount; ++c) {
+        recs[c] = { h.pointCount, counts[c] };
+        h.pointCount += counts[c];
+    }
+    f.write((const char*)&h, sizeof(h));
+    f.write((const char*)recs.data(), std::streamsize(recs.size() * sizeof(BZcurveRec)));
+    static const char pad[16] = {};
+    f.write(pad, std::streamsize(h.pointOffset - sizeof(h) - recs.size() * sizeof(BZcurveRec)));
+    for (uint32_t c = 0; c < curveCount; ++c)
+        f.write((const char*)curvePts[c], std::streamsize(counts[c] * sizeof(BZpoint)));
+    f.close();
+    if (!f) { err = std::string("write failed: ") + path; return false; }
+    return true;
+}
+
+inline bool bzSaveDoc(const char* path, const BZdocView& v, std::string& err) {
+    std::vector<const BZpoint*> p(v.curveCount);
+    std::vector<uint64_t> n(v.curveCount);
+    for (uint32_t c = 0; c < v.curveCount; ++c) {
+        p[c] = v.pts + v.curves[c].first;
+        n[c] = v.curves[c].count;
+    }
+    return bzSaveFile(path, p.data(), n.data(), v.curveCount, err);
+}
+
+// Incremental save: overwrites count points starting at point index first,
+// leaving the rest of the file untouched. The layout must be unchanged.
+inline bool bzPatchPoints(const char* path, uint32_t curveCount, uint64_t first,
+                          const BZpoint* p, uint64_t count, std::string& err) {
+    std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!f) { err = std::string("cannot open ") + path; return false; }
+    f.seekp(std::streamoff(bzPointOffset(curveCount) + first * sizeof(BZpoint)));
+    f.write((const char*)p, std::streamsize(count * sizeof(BZpoint)));
+    f.close();
+    if (!f) { err = std::string("write failed: ") + path; return false; }
+    return true;
+}
+
+// Moves tmp over path, replacing it. Any mapping of path must be closed first.
+inline bool bzReplaceFile(const char* tmp, const char* path) {
+#ifdef _WIN32
+    return MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(tmp, path) == 0;
+#endif
+}
+
+inline bool bzIsBinaryDoc(const char* path) {
+    std::ifstream f(path, std::ios::binary);
+    char magic[4] = {};
+    f.read(magic, 4);
+    return f && memcmp(magic, BZFILE_MAGIC, 4) == 0;
+}
+
+// Text form, for debugging and interchange: one curve per line as
+// "x0 y0 x1 y1 ...", '#' starts a comment.
+inline bool bzReadText(std::istream& in, BZdoc& doc, std::string& err) {
+    std::string line;
+    std::vector<BZpoint> curve;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        std::istringstream ls(line);
+        std::vector<float> v;
+        float f;
+        while (ls >> f) v.push_back(f);
+        if (!ls.eof()) { err = "line " + std::to_string(lineNo) + ": not a number"; return false; }
+        if (v.empty()) continue;
+        if (v.size() % 2) { err = "line " + std::to_string(lineNo) + ": odd number of coordinates"; return false; }
+        curve.clear();
+        for (size_t i = 0; i < v.size(); i += 2)
+            curve.push_back({ v[i], v[i + 1] });
+        doc.addCurve(curve.data(), curve.size());
+    }
+    return true;
+}
+
+inline void bzWriteText(std::ostream& out, const BZdocView& v) {
+    char num[32];
+    for (uint32_t c = 0; c < v.curveCount; ++c) {
+        const BZpoint* p = v.pts + v.curves[c].first;
+        for (uint64_t i = 0; i < v.curves[c].count; ++i) {
+            snprintf(num, sizeof(num), i ? " %.9g %.9g" : "%.9g %.9g", p[i].x, p[i].y);
+            out << num;
+        }
+        out << '\n';
+    }
+}
+
+// A document opened from disk: binary files are mapped, text files parsed.
+struct BZdocFile {
+    BZmapped map;
+    BZdoc text;
+    BZdocView view;
+};
+
+inline void bzClose(BZdocFile& f) {
+    bzUnmap(f.map);
+    f.text = BZdoc();
+    f.view = BZdocView();
+}
+
+inline bool bzOpen(const char* path, BZdocFile& f, std::string& err) {
+    bzClose(f);
+    if (bzIsBinaryDoc(path)) {
+        if (!bzMap(path, f.map)) { err = std::string("cannot map ") + path; return false; }
+        if (!bzViewMapped(f.map, f.view, err)) { bzUnmap(f.map); return false; }
+        return true;
+    }
+    std::ifstream in(path);
+    if (!in) { err = std::string("cannot open ") + path; return false; }
+    if (!bzReadText(in, f.text, err)) return false;
+    f.view = f.text.view();
+    return true;
+}
+
+inline bool bzIsTextPath(const char* path) {
+    size_t n = strlen(path);
+    return n >= 4 && strcmp(path + n - 4, ".txt") == 0;
+}
+
+// Writes v to path as text or as a binary document.
+inline bool bzExport(const char* path, const BZdocView& v, bool text, std::string& err) {
+    if (!text)
+        return bzSaveDoc(path, v, err);
+    std::ofstream out(path);
+    if (!out) { err = std::string("cannot create ") + path; return false; }
+    bzWriteText(out, v);
+    out.close();
+    if (!out) { err = std::string("write failed: ") + path; return false; }
+    return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+#include <fstream>
+
+// Minimal PNG writer for 8-bit grayscale images. The zlib stream uses
+// stored (uncompressed) deflate blocks, so no compression library is
+// needed; files are about the size of the raw pixels.
+
+const size_t PNG_BLOCK = 65535;   // largest stored deflate block
+
+inline uint32_t pngCrc(uint32_t crc, const uint8_t* p, size_t n) {
+    static uint32_t table[256];
+    static bool init = false;
+    if (!init) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        init = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i)
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline uint32_t pngAdler(const uint8_t* p, size_t n) {
+    uint32_t a = 1, b = 0;
+    while (n > 0) {
+        size_t k = std::min<size_t>(n, 5552);   // longest run before b can overflow
+        n -= k;
+        while (k--) {
+            a += *p++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+inline void pngPut32(std::vector<uint8_t>& b, uint32_t v) {
+    b.push_back(uint8_t(v >> 24));
+    b.push_back(uint8_t(v >> 16));
+    b.push_back(uint8_t(v >> 8));
+    b.push_back(uint8_t(v));
+}
+
+inline void pngChunk(std::ostream& out, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> b;
+    pngPut32(b, uint32_t(data.size()));
+    b.insert(b.end(), type, type + 4);
+    b.insert(b.end(), data.begin(), data.end());
+    pngPut32(b, pngCrc(0, b.data() + 4, b.size() - 4));
+    out.write((const char*)b.data(), std::streamsize(b.size()));
+}
+
+// Writes the w x h gray pixels (rows top to bottom, no padding).
+inline bool pngWrite(const char* path, int w, int h, const uint8_t* gray, std::string& err) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f) { err = std::string("cannot create ") + path; return false; }
+    static const uint8_t sig[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    f.write((const char*)sig, 8);
+
+    std::vector<uint8_t> ihdr;
+    pngPut32(ihdr, uint32_t(w));
+    pngPut32(ihdr, uint32_t(h));
+    ihdr.insert(ihdr.end(), { 8, 0, 0, 0, 0 });   // 8-bit gray, no interlace
+    pngChunk(f, "IHDR", ihdr);
+
+    // Every row starts with filter type 0.
+    std::vector<uint8_t> raw;
+    raw.reserve(size_t(w + 1) * h);
+    for (int y = 0; y < h; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), gray + size_t(y) * w, gray + size_t(y + 1) * w);
+    }
+    std::vector<uint8_t> z = { 0x78, 0x01 };
+    z.reserve(raw.size() + raw.size() / PNG_BLOCK * 5 + 16);
+    for (size_t at = 0;; at += PNG_BLOCK) {
+        size_t n = std::min(PNG_BLOCK, raw.size() - at);
+        bool last = at + n >= raw.size();
+        z.push_back(last ? 1 : 0);
+        z.push_back(uint8_t(n));
+        z.push_back(uint8_t(n >> 8));
+        z.push_back(uint8_t(~n));
+        z.push_back(uint8_t(~n >> 8));
+        z.insert(z.end(), raw.begin() + at, raw.begin() + at + n);
+        if (last) break;
+    }
+    pngPut32(z, pngAdler(raw.data(), raw.size()));
+    pngChunk(f, "IDAT", z);
+    pngChunk(f, "IEND", {});
+    f.close();
+    if (!f) { err = std::string("write failed: ") + path; return false; }
+    return true;
+}
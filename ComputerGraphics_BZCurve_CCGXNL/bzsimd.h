@@ -0,0 +1,245 @@
+#pragma once
+#include <algorithm>
+#include "bezier.h"
+
+// Structure-of-arrays de Casteljau kernels evaluating 4/8/16 parameters at
+// once. Every kernel performs exactly the scalar sequence
+// x * (1 - t) + x1 * t per lane with no fused multiply-add, so all of them
+// (and bezierEval) produce bit-identical results.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BZ_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#else
+#define BZ_X86 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define BZ_TARGET(isa)
+#elif defined(__GNUC__) && !defined(__clang__)
+// GCC would otherwise fuse the AVX-512 mul/add pairs into FMAs.
+#define BZ_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#else
+#define BZ_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+enum SimdLevel { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 };
+
+const char* const SIMD_NAMES[] = { "scalar", "sse2", "avx2", "avx512" };
+const int SIMD_MAX_LANES = 16;
+
+#if BZ_X86
+inline void bzCpuid(int leaf, int sub, unsigned r[4]) {
+#ifdef _MSC_VER
+    int v[4];
+    __cpuidex(v, leaf, sub);
+    for (int i = 0; i < 4; ++i) r[i] = unsigned(v[i]);
+#else
+    __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+inline unsigned long long bzXgetbv() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (unsigned long long)hi << 32 | lo;
+#endif
+}
+#endif
+
+inline SimdLevel detectSimd() {
+#if BZ_X86
+    unsigned r[4];
+    bzCpuid(0, 0, r);
+    unsigned maxLeaf = r[0];
+    bzCpuid(1, 0, r);
+    if (!(r[3] & (1u << 26))) return SIMD_SCALAR;
+    bool osxsave = (r[2] & (1u << 27)) != 0;
+    bool avx = (r[2] & (1u << 28)) != 0;
+    if (!osxsave || !avx || maxLeaf < 7) return SIMD_SSE2;
+    unsigned long long xcr0 = bzXgetbv();
+    if ((xcr0 & 0x6) != 0x6) return SIMD_SSE2;
+    bzCpuid(7, 0, r);
+    if (!(r[1] & (1u << 5))) return SIMD_SSE2;
+    if ((r[1] & (1u << 16)) && (xcr0 & 0xe6) == 0xe6) return SIMD_AVX512;
+    return SIMD_AVX2;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+// Level used by bezierBatchSimd; starts at the best the CPU supports.
+inline SimdLevel& simdLevelRef() {
+    static SimdLevel level = detectSimd();
+    return level;
+}
+
+inline SimdLevel simdLevel() { return simdLevelRef(); }
+
+// Forces a lower level (e.g. for comparisons); requests above what the CPU
+// supports are clamped.
+inline void setSimdLevel(SimdLevel l) {
+    simdLevelRef() = std::min(l, detectSimd());
+}
+
+// Scalar fallback with the same lane layout as the vector kernels.
+inline void bezierSoAScalar(const float* px, const float* py, int n, const float* ts, int count,
+                            float* ox, float* oy, float* tx, float* ty) {
+    for (int j = 0; j < count; ++j) {
+        float t = ts[j], s = 1 - t;
+        for (int i = 0; i < n; ++i) {
+            tx[i] = px[i];
+            ty[i] = py[i];
+        }
+        for (int k = 1; k < n; ++k)
+            for (int i = 0; i < n - k; ++i) {
+                tx[i] = tx[i] * s + tx[i + 1] * t;
+                ty[i] = ty[i] * s + ty[i + 1] * t;
+            }
+        ox[j] = tx[0];
+        oy[j] = ty[0];
+    }
+}
+
+// Loads W parameters starting at j, repeating the last one past count.
+inline void simdLoadTs(const float* ts, int j, int count, int w, float* tb) {
+    for (int l = 0; l < w; ++l)
+        tb[l] = ts[std::min(j + l, count - 1)];
+}
+
+inline void simdStoreLanes(const float* tx, const float* ty, int j, int count, int w,
+                           float* ox, float* oy) {
+    int m = std::min(w, count - j);
+    for (int l = 0; l < m; ++l) {
+        ox[j + l] = tx[l];
+        oy[j + l] = ty[l];
+    }
+}
+
+#if BZ_X86
+BZ_TARGET("sse2")
+inline void bezierSoASse2(const float* px, const float* py, int n, const float* ts, int count,
+                          float* ox, float* oy, float* tx, float* ty) {
+    const int W = 4;
+    float tb[W];
+    for (int j = 0; j < count; j += W) {
+        simdLoadTs(ts, j, count, W, tb);
+        __m128 t = _mm_loadu_ps(tb);
+        __m128 s = _mm_sub_ps(_mm_set1_ps(1.0f), t);
+        for (int i = 0; i < n; ++i) {
+            _mm_storeu_ps(tx + i * W, _mm_set1_ps(px[i]));
+            _mm_storeu_ps(ty + i * W, _mm_set1_ps(py[i]));
+        }
+        for (int k = 1; k < n; ++k)
+            for (int i = 0; i < n - k; ++i) {
+                __m128 x = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(tx + i * W), s),
+                                      _mm_mul_ps(_mm_loadu_ps(tx + (i + 1) * W), t));
+                __m128 y = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ty + i * W), s),
+                                      _mm_mul_ps(_mm_loadu_ps(ty + (i + 1) * W), t));
+                _mm_storeu_ps(tx + i * W, x);
+                _mm_storeu_ps(ty + i * W, y);
+            }
+        simdStoreLanes(tx, ty, j, count, W, ox, oy);
+    }
+}
+
+BZ_TARGET("avx2")
+inline void bezierSoAAvx2(const float* px, const float* py, int n, const float* ts, int count,
+                          float* ox, float* oy, float* tx, float* ty) {
+    const int W = 8;
+    float tb[W];
+    for (int j = 0; j < count; j += W) {
+        simdLoadTs(ts, j, count, W, tb);
+        __m256 t = _mm256_loadu_ps(tb);
+        __m256 s = _mm256_sub_ps(_mm256_set1_ps(1.0f), t);
+        for (int i = 0; i < n; ++i) {
+            _mm256_storeu_ps(tx + i * W, _mm256_set1_ps(px[i]));
+            _mm256_storeu_ps(ty + i * W, _mm256_set1_ps(py[i]));
+        }
+        for (int k = 1; k < n; ++k)
+            for (int i = 0; i < n - k; ++i) {
+                __m256 x = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(tx + i * W), s),
+                                         _mm256_mul_ps(_mm256_loadu_ps(tx + (i + 1) * W), t));
+                __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(ty + i * W), s),
+                                         _mm256_mul_ps(_mm256_loadu_ps(ty + (i + 1) * W), t));
+                _mm256_storeu_ps(tx + i * W, x);
+                _mm256_storeu_ps(ty + i * W, y);
+            }
+        simdStoreLanes(tx, ty, j, count, W, ox, oy);
+    }
+    _mm256_zeroupper();
+}
+
+BZ_TARGET("avx512f")
+inline void bezierSoAAvx512(const float* px, const float* py, int n, const float* ts, int count,
+                            float* ox, float* oy, float* tx, float* ty) {
+    const int W = 16;
+    float tb[W];
+    for (int j = 0; j < count; j += W) {
+        simdLoadTs(ts, j, count, W, tb);
+        __m512 t = _mm512_loadu_ps(tb);
+        __m512 s = _mm512_sub_ps(_mm512_set1_ps(1.0f), t);
+        for (int i = 0; i < n; ++i) {
+            _mm512_storeu_ps(tx + i * W, _mm512_set1_ps(px[i]));
+            _mm512_storeu_ps(ty + i * W, _mm512_set1_ps(py[i]));
+        }
+        for (int k = 1; k < n; ++k)
+            for (int i = 0; i < n - k; ++i) {
+                __m512 x = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(tx + i * W), s),
+                                         _mm512_mul_ps(_mm512_loadu_ps(tx + (i + 1) * W), t));
+                __m512 y = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(ty + i * W), s),
+                                         _mm512_mul_ps(_mm512_loadu_ps(ty + (i + 1) * W), t));
+                _mm512_storeu_ps(tx + i * W, x);
+                _mm512_storeu_ps(ty + i * W, y);
+            }
+        simdStoreLanes(tx, ty, j, count, W, ox, oy);
+    }
+    _mm256_zeroupper();
+}
+#endif
+
+// SoA entry point. tx/ty need n * SIMD_MAX_LANES floats each.
+inline void bezierSoA(const float* px, const float* py, int n, const float* ts, int count,
+                      float* ox, float* oy, float* tx, float* ty) {
+    if (n <= 0 || count <= 0) return;
+    switch (simdLevel()) {
+#if BZ_X86
+    case SIMD_AVX512: bezierSoAAvx512(px, py, n, ts, count, ox, oy, tx, ty); break;
+    case SIMD_AVX2:   bezierSoAAvx2(px, py, n, ts, count, ox, oy, tx, ty); break;
+    case SIMD_SSE2:   bezierSoASse2(px, py, n, ts, count, ox, oy, tx, ty); break;
+#endif
+    default:          bezierSoAScalar(px, py, n, ts, count, ox, oy, tx, ty); break;
+    }
+}
+
+// AoS wrapper over bezierSoA, same contract as bezierBatch. Works through the
+// parameters in chunks so the scratch size depends only on n.
+inline void bezierBatchSimd(const BZpoint* p, int n, const float* ts, int count,
+                            BZpoint* out, BZscratch& s) {
+    if (n <= 0) return;
+    const int CHUNK = 256;
+    float* px = s.getf(size_t(n) * (2 + 2 * SIMD_MAX_LANES) + 2 * CHUNK);
+    float* py = px + n;
+    float* tx = py + n;
+    float* ty = tx + n * SIMD_MAX_LANES;
+    float* ox = ty + n * SIMD_MAX_LANES;
+    float* oy = ox + CHUNK;
+    for (int i = 0; i < n; ++i) {
+        px[i] = p[i].x;
+        py[i] = p[i].y;
+    }
+    for (int j = 0; j < count; j += CHUNK) {
+        int m = std::min(CHUNK, count - j);
+        bezierSoA(px, py, n, ts + j, m, ox, oy, tx, ty);
+        for (int l = 0; l < m; ++l)
+            out[j + l] = { ox[l], oy[l] };
+    }
+}
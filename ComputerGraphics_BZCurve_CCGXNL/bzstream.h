@@ -0,0 +1,94 @@
+#pragma once
+#include <GL/glew.h>
+#include "bezier.h"
+
+// Fixed-capacity streaming vertex buffer. The CPU writes vertices straight
+// into mapped buffer memory between streamBegin() and streamEnd().
+//
+// With ARB_buffer_storage the buffer holds STREAM_REGIONS regions, mapped
+// once persistently and used as a ring; a fence after each draw keeps the CPU
+// from overwriting a region the GPU may still read. Without it each update
+// orphans the buffer through an invalidating map so the driver can hand back
+// fresh storage instead of stalling.
+
+const int STREAM_REGIONS = 3;
+
+struct BZstream {
+    GLuint vbo = 0;
+    int capacity = 0;
+    bool persistent = false;
+    BZpoint* mapped = nullptr;
+    GLsync fences[STREAM_REGIONS] = {};
+    int region = 0;
+    int first = 0, count = 0;   // vertex range of the last complete update
+};
+
+// Allocates storage for capacity vertices in vbo and attaches it to vao as
+// attribute 0. If vbo has to be replaced, the new name is written back.
+inline void streamInit(BZstream& st, GLuint vao, GLuint& vbo, int capacity) {
+    st.vbo = vbo;
+    st.capacity = capacity;
+    st.persistent = GLEW_ARB_buffer_storage != 0;
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (st.persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr size = GLsizeiptr(capacity) * STREAM_REGIONS * sizeof(BZpoint);
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        st.mapped = (BZpoint*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if (!st.mapped) {
+            // Immutable storage can't be respecified, so start over with a new name.
+            glDeleteBuffers(1, &st.vbo);
+            glGenBuffers(1, &st.vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, st.vbo);
+            vbo = st.vbo;
+            st.persistent = false;
+        }
+    }
+    if (!st.persistent)
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(capacity) * sizeof(BZpoint), nullptr, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(0);
+}
+
+// Returns room for st.capacity vertices. Must be followed by streamEnd().
+inline BZpoint* streamBegin(BZstream& st) {
+    if (st.persistent) {
+        st.region = (st.region + 1) % STREAM_REGIONS;
+        GLsync& f = st.fences[st.region];
+        if (f) {
+            while (glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(f);
+            f = nullptr;
+        }
+        return st.mapped + st.region * st.capacity;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, st.vbo);
+    return (BZpoint*)glMapBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(st.capacity) * sizeof(BZpoint),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+}
+
+// Publishes the count vertices written since streamBegin().
+inline void streamEnd(BZstream& st, int count) {
+    st.count = count;
+    if (st.persistent) {
+        st.first = st.region * st.capacity;
+        return;
+    }
+    st.first = 0;
+    glBindBuffer(GL_ARRAY_BUFFER, st.vbo);
+    glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(count) * sizeof(BZpoint));
+    if (!glUnmapBuffer(GL_ARRAY_BUFFER))
+        st.count = 0;   // contents lost (e.g. mode switch); redrawn on the next update
+}
+
+// Draws the current range; the VAO for st.vbo must be bound.
+inline void streamDraw(BZstream& st, GLenum mode) {
+    if (st.count <= 0) return;
+    glDrawArrays(mode, st.first, st.count);
+    if (st.persistent) {
+        GLsync& f = st.fences[st.region];
+        if (f) glDeleteSync(f);
+        f = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
@@ -0,0 +1,269 @@
+// Headless tessellator: reads control polygons, tessellates them with the
+// same code as the editor and writes the polylines. No window or GL context.
+//
+// Input: a binary curve document (.bzc, see bzfile.h), mapped in place, or
+// text with one curve per line as "x0 y0 x1 y1 ...", '#' starts a comment.
+// CSV output: "curve,x,y" rows. Binary output: per curve a uint32 vertex
+// count followed by that many little-endian float x, y pairs.
+// With --intersect, writes the crossings between all input curves instead,
+// as "a,b,ta,tb,x,y" rows. With --render, rasterizes the document with
+// anti-aliasing into a grayscale PNG instead.
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "bezier.h"
+#include "tessellate.h"
+#include "bzsimd.h"
+#include "spline.h"
+#include "bench.h"
+#include "bzfile.h"
+#include "intersect.h"
+#include "raster.h"
+#include "bzpng.h"
+
+enum ToolMode { MODE_UNIFORM, MODE_FWDDIFF, MODE_DECASTELJAU, MODE_SIMD, MODE_ADAPTIVE, MODE_BSPLINE, MODE_CATMULL, MODE_FIXED, MODE_BERNSTEIN };
+
+const char* const MODE_NAMES[] = { "uniform", "fwddiff", "decasteljau", "simd", "adaptive", "bspline", "catmull", "fixed", "bernstein" };
+const int MODE_COUNT = 9;
+
+struct Options {
+    ToolMode mode = MODE_UNIFORM;
+    int samples = 1001;
+    float tol = 0.00125f;   // half a pixel in the editor's 800x800 window
+    int repeat = 1;
+    bool binary = false;
+    bool quiet = false;
+    bool intersect = false;
+    int threads = 0;
+    std::string render;
+    BZrenderOptions raster;
+    std::string in = "-";
+    std::string out;
+    std::string convert;
+};
+
+void usage() {
+    fprintf(stderr,
+        "usage: bztess [options] [input|-]\n"
+        "  --mode M       uniform (default), fwddiff, decasteljau, simd, adaptive, bspline, catmull,\n"
+        "                 fixed (degree-specialized up to quartics), bernstein (O(n) for high degrees)\n"
+        "  --samples N    vertices per curve for the uniform modes (default 1001)\n"
+        "  --tol T        adaptive flatness tolerance in curve units (default 0.00125)\n"
+        "  --format F     csv (default) or bin; bin requires --out\n"
+        "  --out FILE     output file (default stdout)\n"
+        "  --repeat N     tessellate the input N times, for throughput measurements\n"
+        "  --simd L       limit the SIMD level: scalar, sse2, avx2, avx512\n"
+        "  --quiet        no output, throughput only\n"
+        "  --convert FILE also save the input as a document (.txt: text, otherwise binary)\n"
+        "  --intersect    write the intersections between all curves (tolerance --tol)\n"
+        "  --threads N    threads for --intersect and --render (default: all cores)\n"
+        "  --render FILE  rasterize the curves into an anti-aliased grayscale PNG\n"
+        "  --size N       longest side of the rendered image in pixels (default 1024)\n"
+        "  --stroke PX    stroke width for --render, 0 for none (default 1)\n"
+        "  --fill R       also fill each curve closed by its chord: evenodd or nonzero\n"
+        "  --bench        run the micro-benchmarks and exit\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(a, "--mode") && v) {
+            int m = 0;
+            while (m < MODE_COUNT && strcmp(v, MODE_NAMES[m])) ++m;
+            if (m == MODE_COUNT) return false;
+            o.mode = ToolMode(m);
+            ++i;
+        }
+        else if (!strcmp(a, "--samples") && v) { o.samples = atoi(v); ++i; }
+        else if (!strcmp(a, "--tol") && v) { o.tol = float(atof(v)); ++i; }
+        else if (!strcmp(a, "--repeat") && v) { o.repeat = atoi(v); ++i; }
+        else if (!strcmp(a, "--out") && v) { o.out = v; ++i; }
+        else if (!strcmp(a, "--convert") && v) { o.convert = v; ++i; }
+        else if (!strcmp(a, "--format") && v) {
+            if (!strcmp(v, "bin")) o.binary = true;
+            else if (strcmp(v, "csv")) return false;
+            ++i;
+        }
+        else if (!strcmp(a, "--simd") && v) {
+            int l = 0;
+            while (l <= SIMD_AVX512 && strcmp(v, SIMD_NAMES[l])) ++l;
+            if (l > SIMD_AVX512) return false;
+            setSimdLevel(SimdLevel(l));
+            ++i;
+        }
+        else if (!strcmp(a, "--threads") && v) { o.threads = atoi(v); ++i; }
+        else if (!strcmp(a, "--render") && v) { o.render = v; ++i; }
+        else if (!strcmp(a, "--size") && v) { o.raster.size = atoi(v); ++i; }
+        else if (!strcmp(a, "--stroke") && v) { o.raster.strokePx = float(atof(v)); ++i; }
+        else if (!strcmp(a, "--fill") && v) {
+            if (!strcmp(v, "evenodd")) o.raster.rule = FILL_EVEN_ODD;
+            else if (!strcmp(v, "nonzero")) o.raster.rule = FILL_NONZERO;
+            else return false;
+            o.raster.fill = true;
+            ++i;
+        }
+        else if (!strcmp(a, "--quiet")) o.quiet = true;
+        else if (!strcmp(a, "--intersect")) o.intersect = true;
+        else if (a[0] == '-' && a[1]) return false;
+        else o.in = a;
+    }
+    if (o.samples < 2 || o.repeat < 1 || !(o.tol > 0)) return false;
+    if (o.binary && o.out.empty() && !o.quiet) return false;
+    if (o.intersect && o.binary) return false;
+    if (o.raster.size < 1 || o.raster.size > 16384 || !(o.raster.strokePx >= 0)) return false;
+    return true;
+}
+
+struct Tessellator {
+    Options opt;
+    std::vector<float> ts;
+    std::vector<BZpoint> out;
+    BZscratch scratch;
+    BZfwdDiff fd;
+    BZspline spline;
+
+    explicit Tessellator(const Options& o) : opt(o), ts(o.samples) {
+        uniformParams(ts.data(), o.samples);
+        out.resize(std::max(o.samples, (1 << ADAPT_MAX_DEPTH) + 1));
+        spline.kind = o.mode == MODE_CATMULL ? SPLINE_CATMULL_ROM : SPLINE_BSPLINE;
+    }
+
+    // Tessellates one curve; returns the vertices and their count.
+    const BZpoint* run(const BZpoint* p, int n, int& count) {
+        count = opt.samples;
+        switch (opt.mode) {
+        case MODE_UNIFORM:     tessUniform(p, n, ts.data(), count, out.data(), fd, scratch); break;
+        case MODE_FWDDIFF:     bezierFwdDiff(p, n, count, out.data(), fd, scratch); break;
+        case MODE_DECASTELJAU: bezierBatch(p, n, ts.data(), count, out.data(), scratch); break;
+        case MODE_SIMD:        bezierBatchSimd(p, n, ts.data(), count, out.data(), scratch); break;
+        case MODE_FIXED:       bezierBatchFast(p, n, ts.data(), count, out.data(), scratch); break;
+        case MODE_BERNSTEIN:   bezierBatchHigh(p, n, ts.data(), count, out.data()); break;
+        case MODE_ADAPTIVE:
+            count = bezierAdaptive(p, n, opt.tol, out.data(), int(out.size()), scratch);
+            break;
+        case MODE_BSPLINE:
+        case MODE_CATMULL:
+            splineRebuild(spline, p, n);
+            count = splineVertexCount(spline);
+            return spline.verts.data();
+        }
+        return out.data();
+    }
+};
+
+int main(int argc, char** argv) {
+    if (argc > 1 && !strcmp(argv[1], "--bench")) {
+        runBenchmarks();
+        return 0;
+    }
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    BZdocFile doc;
+    std::string err;
+    bool ok;
+    if (opt.in == "-") {
+        ok = bzReadText(std::cin, doc.text, err);
+        doc.view = doc.text.view();
+    }
+    else
+        ok = bzOpen(opt.in.c_str(), doc, err);
+    if (!ok) {
+        fprintf(stderr, "bztess: %s\n", err.c_str());
+        return 1;
+    }
+    if (!opt.convert.empty() && !bzExport(opt.convert.c_str(), doc.view, bzIsTextPath(opt.convert.c_str()), err)) {
+        fprintf(stderr, "bztess: %s\n", err.c_str());
+        return 1;
+    }
+    int curves = int(doc.view.curveCount);
+
+    if (!opt.render.empty()) {
+        BZpool pool;
+        poolStart(pool, opt.threads);
+        BZimage img;
+        auto t0 = std::chrono::steady_clock::now();
+        renderDocument(pool, doc.view, opt.raster, img);
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (!pngWrite(opt.render.c_str(), img.w, img.h, img.gray.data(), err)) {
+            fprintf(stderr, "bztess: %s\n", err.c_str());
+            return 1;
+        }
+        fprintf(stderr, "bztess: %d curves rendered at %dx%d in %.3f ms on %d threads\n",
+            curves, img.w, img.h, sec * 1e3, poolSize(pool));
+        return 0;
+    }
+
+    std::ofstream fout;
+    if (!opt.out.empty() && !opt.quiet) {
+        fout.open(opt.out, opt.binary ? std::ios::binary : std::ios::out);
+        if (!fout) {
+            fprintf(stderr, "bztess: cannot create %s\n", opt.out.c_str());
+            return 1;
+        }
+    }
+    std::ostream& os = opt.out.empty() ? std::cout : fout;
+    char row[96];
+
+    if (opt.intersect) {
+        std::vector<BZxhit> hits;
+        size_t pairs = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        intersectAll(doc.view, opt.tol, opt.threads, hits, &pairs);
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (!opt.quiet)
+            for (const BZxhit& h : hits) {
+                snprintf(row, sizeof(row), "%d,%d,%.7g,%.7g,%.9g,%.9g\n", h.a, h.b, h.ta, h.tb, h.pos.x, h.pos.y);
+                os << row;
+            }
+        os.flush();
+        fprintf(stderr, "bztess: %d curves, %zu candidate pairs, %zu intersections in %.3f ms\n",
+            curves, pairs, hits.size(), sec * 1e3);
+        return os ? 0 : 1;
+    }
+
+    Tessellator tess(opt);
+    long long verts = 0;
+    double tessSec = 0;
+    for (int r = 0; r < opt.repeat; ++r) {
+        for (int c = 0; c < curves; ++c) {
+            int count;
+            auto t0 = std::chrono::steady_clock::now();
+            const BZcurveRec& rec = doc.view.curves[c];
+            const BZpoint* v = tess.run(doc.view.pts + rec.first, int(rec.count), count);
+            tessSec += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            verts += count;
+            // Only the first pass is written; repeats are for timing.
+            if (opt.quiet || r > 0) continue;
+            if (opt.binary) {
+                uint32_t n = uint32_t(count);
+                os.write((const char*)&n, sizeof(n));
+                os.write((const char*)v, std::streamsize(count) * sizeof(BZpoint));
+            }
+            else
+                for (int i = 0; i < count; ++i) {
+                    snprintf(row, sizeof(row), "%d,%.9g,%.9g\n", c, v[i].x, v[i].y);
+                    os << row;
+                }
+        }
+    }
+    os.flush();
+
+    long long total = (long long)curves * opt.repeat;
+    fprintf(stderr, "bztess: %s (%s), %lld curves, %lld vertices in %.3f ms: %.0f curves/s, %.0f vertices/s\n",
+        MODE_NAMES[opt.mode], SIMD_NAMES[simdLevel()], total, verts, tessSec * 1e3,
+        tessSec > 0 ? total / tessSec : 0.0, tessSec > 0 ? verts / tessSec : 0.0);
+    return os ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cfloat>
+#include "bezier.h"
+#include "tessellate.h"
+#include "bounds.h"
+
+// Closest point on a set of curves. Each curve is split into 2^PICK_DEPTH
+// pieces whose control-point boxes bound them (convex hull property); a
+// bounding volume hierarchy over the pieces prunes everything farther than
+// the best hit so far, and the surviving pieces are searched by sampling
+// followed by Newton iterations on (P(t) - q) . P'(t) = 0.
+
+const int PICK_DEPTH = 3;
+const int PICK_LEAF = 4;        // pieces per leaf
+const int PICK_SAMPLES = 4;     // starting guesses per piece
+const int PICK_NEWTON = 4;
+
+struct BZpickCurve {
+    size_t ctrl, d1, d2;   // offsets into the point, first and second derivative arrays
+    int n;
+};
+
+struct BZpickPiece {
+    BZbox box;
+    int curve;
+    float t0, t1;
+};
+
+// Internal nodes have count 0 and children at child and child + 1; leaves
+// cover pieces [child, child + count).
+struct BZpickNode {
+    BZbox box;
+    int child, count;
+};
+
+struct BZpickHit {
+    int curve = -1;
+    float t = 0;
+    float dist = FLT_MAX;
+    BZpoint pos = { 0, 0 };
+};
+
+struct BZcurveIndex {
+    std::vector<BZpoint> ctrl, d1, d2;
+    std::vector<BZpickCurve> curves;
+    std::vector<BZpickPiece> pieces;
+    std::vector<BZpickNode> nodes;
+    std::vector<int> stack;
+    std::vector<BZpoint> split;
+    BZscratch scratch;
+};
+
+inline void pickClear(BZcurveIndex& x) {
+    x.ctrl.clear();
+    x.d1.clear();
+    x.d2.clear();
+    x.curves.clear();
+    x.pieces.clear();
+    x.nodes.clear();
+}
+
+// Adds a curve; its id is the number of curves added before it.
+inline void pickAddCurve(BZcurveIndex& x, const BZpoint* p, int n) {
+    BZpickCurve c;
+    c.n = n;
+    c.ctrl = x.ctrl.size();
+    c.d1 = x.d1.size();
+    c.d2 = x.d2.size();
+    int id = int(x.curves.size());
+    x.curves.push_back(c);
+    if (n <= 0) return;
+    x.ctrl.insert(x.ctrl.end(), p, p + n);
+    x.d1.resize(c.d1 + std::max(n - 1, 1));
+    x.d2.resize(c.d2 + std::max(n - 2, 1));
+    x.d1[c.d1] = x.d2[c.d2] = { 0, 0 };
+    hodograph(p, n, &x.d1[c.d1]);
+    hodograph(&x.d1[c.d1], n - 1, &x.d2[c.d2]);
+
+    // Halve every piece PICK_DEPTH times, level by level.
+    const int P = 1 << PICK_DEPTH;
+    x.split.resize(size_t(n) * (2 * P + 2));
+    BZpoint* cur = x.split.data();
+    BZpoint* next = cur + size_t(n) * P;
+    BZpoint* right = next + size_t(n) * P;
+    BZpoint* tmp = right + n;
+    std::copy(p, p + n, cur);
+    for (int level = 0, pieces = 1; level < PICK_DEPTH; ++level, pieces *= 2) {
+        for (int i = 0; i < pieces; ++i) {
+            splitHalf(cur + size_t(i) * n, n, next + size_t(2 * i) * n, right, tmp);
+            std::copy(right, right + n, next + size_t(2 * i + 1) * n);
+        }
+        std::swap(cur, next);
+    }
+    for (int i = 0; i < P; ++i) {
+        BZpickPiece pc;
+        pc.box = hullBox(cur + size_t(i) * n, n);
+        pc.curve = id;
+        pc.t0 = float(i) / P;
+        pc.t1 = float(i + 1) / P;
+        x.pieces.push_back(pc);
+    }
+}
+
+inline void pickBuildNode(BZcurveIndex& x, int node, int first, int count) {
+    BZbox b, centers;
+    for (int i = first; i < first + count; ++i) {
+        const BZbox& pb = x.pieces[i].box;
+        b.grow(pb);
+        centers.grow(BZpoint{ (pb.x0 + pb.x1) * 0.5f, (pb.y0 + pb.y1) * 0.5f });
+    }
+    x.nodes[node].box = b;
+    if (count <= PICK_LEAF) {
+        x.nodes[node].child = first;
+        x.nodes[node].count = count;
+        return;
+    }
+    // Median split on the wider axis of the piece centres.
+    bool alongX = centers.x1 - centers.x0 >= centers.y1 - centers.y0;
+    int half = count / 2;
+    std::nth_element(x.pieces.begin() + first, x.pieces.begin() + first + half, x.pieces.begin() + first + count,
+        [alongX](const BZpickPiece& a, const BZpickPiece& c) {
+            return alongX ? a.box.x0 + a.box.x1 < c.box.x0 + c.box.x1 : a.box.y0 + a.box.y1 < c.box.y0 + c.box.y1;
+        });
+    int child = int(x.nodes.size());
+    x.nodes.resize(child + 2);
+    x.nodes[node].child = child;
+    x.nodes[node].count = 0;
+    pickBuildNode(x, child, first, half);
+    pickBuildNode(x, child + 1, first + half, count - half);
+}
+
+// Builds the hierarchy over the curves added since pickClear().
+inline void pickBuild(BZcurveIndex& x) {
+    x.nodes.clear();
+    if (x.pieces.empty()) return;
+    x.nodes.reserve(2 * x.pieces.size() / PICK_LEAF + 2);
+    x.nodes.resize(1);
+    pickBuildNode(x, 0, 0, int(x.pieces.size()));
+}
+
+// Nearest point of one piece to q: best of PICK_SAMPLES + 1 samples, then
+// Newton steps clamped to the piece.
+inline void pickPiece(BZcurveIndex& x, const BZpickPiece& pc, BZpoint q, BZpickHit& best) {
+    const BZpickCurve& c = x.curves[pc.curve];
+    const BZpoint* p = &x.ctrl[c.ctrl];
+    BZpoint* tmp = x.scratch.get(c.n);
+    float t = pc.t0, d2 = FLT_MAX;
+    for (int i = 0; i <= PICK_SAMPLES; ++i) {
+        float s = pc.t0 + (pc.t1 - pc.t0) * i / PICK_SAMPLES;
+        BZpoint v = bezierEvalFast(s, p, c.n, tmp);
+        float e = (v.x - q.x) * (v.x - q.x) + (v.y - q.y) * (v.y - q.y);
+        if (e < d2) {
+            d2 = e;
+            t = s;
+        }
+    }
+    BZpoint pos = bezierEvalFast(t, p, c.n, tmp);
+    for (int it = 0; it < PICK_NEWTON && c.n > 1; ++it) {
+        BZpoint d = bezierEvalFast(t, &x.d1[c.d1], c.n - 1, tmp);
+        BZpoint dd = c.n > 2 ? bezierEvalFast(t, &x.d2[c.d2], c.n - 2, tmp) : BZpoint{ 0, 0 };
+        float rx = pos.x - q.x, ry = pos.y - q.y;
+        float f = rx * d.x + ry * d.y;
+        float df = d.x * d.x + d.y * d.y + rx * dd.x + ry * dd.y;
+        if (!(df > 0)) break;
+        float nt = std::min(std::max(t - f / df, pc.t0), pc.t1);
+        BZpoint np = bezierEvalFast(nt, p, c.n, tmp);
+        float e = (np.x - q.x) * (np.x - q.x) + (np.y - q.y) * (np.y - q.y);
+        if (e >= d2) break;
+        t = nt;
+        pos = np;
+        d2 = e;
+    }
+    if (d2 < best.dist * best.dist) {
+        best.curve = pc.curve;
+        best.t = t;
+        best.dist = std::sqrt(d2);
+        best.pos = pos;
+    }
+}
+
+// Closest point to q on any curve within maxDist; false if there is none.
+inline bool pickClosest(BZcurveIndex& x, BZpoint q, float maxDist, BZpickHit& hit) {
+    hit = BZpickHit();
+    hit.dist = maxDist;
+    if (x.nodes.empty()) return false;
+    x.stack.clear();
+    x.stack.push_back(0);
+    while (!x.stack.empty()) {
+        const BZpickNode& nd = x.nodes[x.stack.back()];
+        x.stack.pop_back();
+        if (nd.box.dist2(q) >= hit.dist * hit.dist) continue;
+        if (nd.count > 0) {
+            for (int i = nd.child; i < nd.child + nd.count; ++i)
+                if (x.pieces[i].box.dist2(q) < hit.dist * hit.dist)
+                    pickPiece(x, x.pieces[i], q, hit);
+            continue;
+        }
+        // Nearer child on top of the stack.
+        int a = nd.child, b = nd.child + 1;
+        if (x.nodes[a].box.dist2(q) < x.nodes[b].box.dist2(q)) std::swap(a, b);
+        x.stack.push_back(a);
+        x.stack.push_back(b);
+    }
+    return hit.curve >= 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include "bezier.h"
+
+// Point edits recorded by the input callbacks and applied once per frame.
+enum EditKind { EDIT_MOVE, EDIT_INSERT, EDIT_ERASE };
+
+struct BZedit {
+    EditKind kind;
+    int idx;
+    BZpoint pos;
+};
+
+struct BZeditQueue {
+    std::vector<BZedit> edits;
+    long long recorded = 0;    // edits handed to queueEdit
+    long long coalesced = 0;   // moves merged into an earlier move of the same point
+};
+
+// A move of the point the last queued edit also moved replaces that edit,
+// so a burst of cursor events within one frame costs one queue entry.
+inline void queueEdit(BZeditQueue& q, EditKind kind, int idx, BZpoint pos) {
+    ++q.recorded;
+    if (kind == EDIT_MOVE && !q.edits.empty()) {
+        BZedit& last = q.edits.back();
+        if (last.kind == EDIT_MOVE && last.idx == idx) {
+            last.pos = pos;
+            ++q.coalesced;
+            return;
+        }
+    }
+    q.edits.push_back({ kind, idx, pos });
+}
@@ -0,0 +1,548 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+#include "bezier.h"
+#include "tessellate.h"
+
+// Filling closed paths. Each contour is a closed polyline (the last point
+// joins the first); curves are flattened into contours first with
+// fillAppendCurve().
+//
+// Triangulation is a sweep-line trapezoidal decomposition. The edges
+// crossing the sweep line are kept in x order, each with the winding
+// number to its right, and every run of spans that is inside under the
+// fill rule is an open trapezoid (two triangles) for as long as the same
+// two edges bound it. The sweep stops at vertex heights and where two
+// neighbouring edges cross, as in Bentley-Ottmann, and a stop only looks
+// at the runs around the edges it moved, and only when one of them starts
+// or ends a run there, so its cost does not grow with the number of edges
+// crossing the line. Crossings swap the two edges, so
+// self-intersecting and overlapping contours come out right under both
+// even-odd and nonzero.
+//
+// The trapezoids are kept as records of their two edges and y range, with
+// their triangles at the same index in tris. Moving points only re-sweeps
+// the y window their edges span, before and after the move: the trapezoids
+// overlapping it are replaced, and the parts of them above and below the
+// window are joined again with the runs the sweep finds at its ends, so a
+// drag leaves no extra cuts behind.
+
+enum FillRule { FILL_EVEN_ODD, FILL_NONZERO };
+
+const char* const FILL_RULE_NAMES[] = { "even-odd", "nonzero" };
+
+struct BZfillEdge {
+    float x0, y0, x1, y1;   // y0 < y1
+    float dxdy;
+    int dir;                // +1 if the contour runs towards +y
+    int id;                 // index of the edge's start in BZfill::pts
+};
+
+struct BZfillTrap {
+    int left, right;        // edge ids
+    float y0, y1;
+};
+
+// Neighbours l and r on the sweep line that cross at y.
+struct BZfillCross {
+    float y;
+    int l, r;
+};
+
+struct BZfill {
+    FillRule rule = FILL_NONZERO;
+    std::vector<BZpoint> pts;
+    std::vector<int> next;          // next point along the contour
+    std::vector<int> prev;
+    std::vector<BZfillEdge> edges;  // every edge by y0, horizontal ones with dir 0
+    std::vector<BZfillTrap> traps;
+    std::vector<BZpoint> tris;      // six points per trapezoid, in traps order
+
+    // Sweep scratch. Edges on the sweep line are indices into active, linked
+    // in x order between the sentinels active.size() and active.size() + 1.
+    float winTop = 0, winBot = 0;   // y window being swept
+    std::vector<BZfillEdge> active;
+    std::vector<int> activeOf;      // edge id -> index in active, or -1
+    std::vector<int> byEnd;         // active by y1
+    std::vector<std::pair<float, int>> keys;
+    std::vector<float> ys;
+    std::vector<int> left, right;   // links, -1 off the line
+    std::vector<int> wind;          // winding number right of the edge
+    std::vector<int> openRight;     // open trapezoids by left edge
+    std::vector<float> openY;
+    std::vector<int> bound;         // fillBound() as of the last fillRuns()
+    std::vector<int> mark, runMark, runRight;
+    int stamp = 0, runStamp = 0;
+    std::vector<int> touched, gone, inserts, ranges;
+    std::vector<BZfillCross> crossings;   // heap, earliest first
+    // Pieces of replaced trapezoids ending at winTop or starting at winBot,
+    // indexed by left edge id; a used one has right = -1.
+    std::vector<BZfillTrap> stubs;
+    std::vector<int> stubTop, stubBot;
+};
+
+// Flattens one curve onto the contour in out, dropping the first point if
+// it repeats the last one.
+inline void fillAppendCurve(std::vector<BZpoint>& out, const BZpoint* p, int n, float tol, BZscratch& s) {
+    size_t at = out.size();
+    out.resize(at + (size_t(1) << ADAPT_MAX_DEPTH) + 1);
+    int count = bezierAdaptive(p, n, tol, out.data() + at, (1 << ADAPT_MAX_DEPTH) + 1, s);
+    out.resize(at + count);
+    if (at > 0 && count > 0 && out[at - 1].x == out[at].x && out[at - 1].y == out[at].y)
+        out.erase(out.begin() + at);
+}
+
+inline float fillEdgeX(const BZfillEdge& e, float y) {
+    return y >= e.y1 ? e.x1 : e.x0 + (y - e.y0) * e.dxdy;
+}
+
+inline bool fillEdge(const BZfill& f, int i, BZfillEdge& e) {
+    BZpoint a = f.pts[i], b = f.pts[f.next[i]];
+    e.dir = a.y < b.y ? 1 : a.y > b.y ? -1 : 0;
+    if (e.dir < 0) std::swap(a, b);
+    e.x0 = a.x;
+    e.y0 = a.y;
+    e.x1 = b.x;
+    e.y1 = b.y;
+    e.dxdy = e.dir != 0 ? (b.x - a.x) / (b.y - a.y) : 0;
+    e.id = i;
+    return e.dir != 0;
+}
+
+inline bool fillInside(FillRule rule, int w) {
+    return rule == FILL_NONZERO ? w != 0 : (w & 1) != 0;
+}
+
+// Order of f.edges: by y0, then x0, so that edges starting together come
+// out nearly sorted for the sweep.
+inline bool fillAbove(const BZfillEdge& a, const BZfillEdge& b) {
+    return a.y0 < b.y0 || (a.y0 == b.y0 && a.x0 < b.x0);
+}
+
+// Whether active edge a is left of b just below y.
+inline bool fillBefore(const BZfill& f, int a, int b, float y) {
+    float xa = fillEdgeX(f.active[a], y), xb = fillEdgeX(f.active[b], y);
+    return xa < xb || (xa == xb && f.active[a].dxdy < f.active[b].dxdy);
+}
+
+// 1 if active edge e starts a run, 2 if it ends one, 0 otherwise.
+inline int fillBound(const BZfill& f, int e) {
+    bool was = fillInside(f.rule, f.wind[f.left[e]]), now = fillInside(f.rule, f.wind[e]);
+    return was == now ? 0 : now ? 1 : 2;
+}
+
+inline bool fillLater(const BZfillCross& a, const BZfillCross& b) {
+    return a.y > b.y;
+}
+
+inline void fillLink(BZfill& f, int a, int b) {
+    f.right[a] = b;
+    f.left[b] = a;
+}
+
+inline void fillTouch(BZfill& f, int e) {
+    if (e < int(f.active.size()) && f.mark[e] != f.stamp) {
+        f.mark[e] = f.stamp;
+        f.touched.push_back(e);
+    }
+}
+
+inline void fillAddTrap(BZfill& f, const BZfillEdge& a, const BZfillEdge& b, float y0, float y1) {
+    f.traps.push_back({ a.id, b.id, y0, y1 });
+    BZpoint p0 = { fillEdgeX(a, y0), y0 }, p1 = { fillEdgeX(b, y0), y0 };
+    BZpoint p2 = { fillEdgeX(a, y1), y1 }, p3 = { fillEdgeX(b, y1), y1 };
+    f.tris.push_back(p0);
+    f.tris.push_back(p1);
+    f.tris.push_back(p2);
+    f.tris.push_back(p1);
+    f.tris.push_back(p3);
+    f.tris.push_back(p2);
+}
+
+// Start of a run of active edges l and r opening at y: a piece above the
+// window with the same edges is continued.
+inline float fillOpenY(BZfill& f, int l, int r, float y) {
+    if (y != f.winTop) return y;
+    int s = f.stubTop[f.active[l].id];
+    if (s < 0 || f.stubs[s].right != f.active[r].id) return y;
+    f.stubs[s].right = -1;
+    return f.stubs[s].y0;
+}
+
+// Closes the trapezoid whose left edge is l at y1.
+inline void fillEmit(BZfill& f, int l, float y1) {
+    const BZfillEdge& a = f.active[l];
+    const BZfillEdge& b = f.active[f.openRight[l]];
+    float y0 = f.openY[l];
+    f.openRight[l] = -1;
+    if (y1 <= y0) return;
+    if (y1 == f.winBot) {
+        // Continued by a piece below the window.
+        int s = f.stubBot[a.id];
+        if (s >= 0 && f.stubs[s].right == b.id) {
+            y1 = f.stubs[s].y1;
+            f.stubs[s].right = -1;
+        }
+    }
+    fillAddTrap(f, a, b, y0, y1);
+}
+
+// Queues the crossing of neighbours l and r if they swap before either ends.
+inline void fillCheckCross(BZfill& f, int l, int r, float y) {
+    int n = int(f.active.size());
+    if (l >= n || r >= n) return;
+    const BZfillEdge& a = f.active[l];
+    const BZfillEdge& b = f.active[r];
+    float ye = std::min(std::min(a.y1, b.y1), f.winBot);
+    float gapBot = fillEdgeX(a, ye) - fillEdgeX(b, ye);
+    if (!(gapBot > 0)) return;
+    float gapTop = std::max(fillEdgeX(b, y) - fillEdgeX(a, y), 0.0f);
+    float yc = y + gapTop / (gapTop + gapBot) * (ye - y);
+    // Too close to split off a trapezoid: swap right away.
+    if (yc - y <= 1e-6f * (std::fabs(y) + std::fabs(ye)) + FLT_MIN)
+        yc = y;
+    f.crossings.push_back({ yc, l, r });
+    std::push_heap(f.crossings.begin(), f.crossings.end(), fillLater);
+}
+
+// Brings the runs between edges s and t, widened to whole runs, up to date
+// at y: trapezoids whose edges changed are emitted, new ones opened.
+inline void fillRuns(BZfill& f, int s, int t, float y) {
+    int tail = int(f.active.size()) + 1;
+    while (fillInside(f.rule, f.wind[f.left[s]]))
+        s = f.left[s];
+    while (f.right[t] != tail && fillInside(f.rule, f.wind[t]))
+        t = f.right[t];
+    ++f.runStamp;
+    int start = -1;
+    for (int e = s; ; e = f.right[e]) {
+        bool was = fillInside(f.rule, f.wind[f.left[e]]), now = fillInside(f.rule, f.wind[e]);
+        f.bound[e] = fillBound(f, e);
+        if (!was && now)
+            start = e;
+        else if (was && !now && start >= 0) {
+            f.runMark[start] = f.runStamp;
+            f.runRight[start] = e;
+        }
+        if (e == t) break;
+    }
+    for (int e = s; ; e = f.right[e]) {
+        bool run = f.runMark[e] == f.runStamp;
+        if (f.openRight[e] >= 0 && (!run || f.runRight[e] != f.openRight[e]))
+            fillEmit(f, e, y);
+        if (run && f.openRight[e] < 0) {
+            f.openRight[e] = f.runRight[e];
+            f.openY[e] = fillOpenY(f, e, f.runRight[e], y);
+        }
+        if (e == t) break;
+    }
+}
+
+// After the line changed at y around the touched edges: fixes the winding
+// numbers, then the runs, and queues the crossings of new neighbours.
+inline void fillSettle(BZfill& f, float y) {
+    int tail = int(f.active.size()) + 1;
+    bool same = true;
+    for (int o : f.gone)
+        if (f.bound[o]) same = false;
+    // The windings right of a change are off until the next change that
+    // makes up for it; walk until they agree again.
+    f.ranges.clear();
+    for (int t : f.touched) {
+        if (f.left[t] < 0 || f.mark[t] != f.stamp) continue;
+        int s = t;
+        while (f.mark[f.left[s]] == f.stamp)
+            s = f.left[s];
+        int w = f.wind[f.left[s]], last = s;
+        for (int e = s; e != tail; e = f.right[e]) {
+            w += f.active[e].dir;
+            if (f.mark[e] != f.stamp && f.wind[e] == w) break;
+            f.wind[e] = w;
+            f.mark[e] = 0;
+            last = e;
+        }
+        f.ranges.push_back(s);
+        f.ranges.push_back(last);
+        // Unless an edge went in or out of being a run's end, the runs are
+        // as they were and need not be walked.
+        int stop = f.right[last];
+        for (int e = s; same && e != tail; e = f.right[e]) {
+            same = fillBound(f, e) == f.bound[e];
+            if (e == stop) break;
+        }
+    }
+    if (!same)
+        for (size_t k = 0; k < f.ranges.size(); k += 2)
+            fillRuns(f, f.ranges[k], f.ranges[k + 1], y);
+    for (int o : f.gone)
+        if (f.openRight[o] >= 0)
+            fillEmit(f, o, y);
+    for (int t : f.touched)
+        if (f.left[t] >= 0) {
+            fillCheckCross(f, f.left[t], t, y);
+            fillCheckCross(f, t, f.right[t], y);
+        }
+}
+
+// Edges ending at y leave the line and edges starting there join it.
+inline void fillLevel(BZfill& f, float y, size_t& enter, size_t& leave) {
+    int n = int(f.active.size()), head = n, tail = n + 1;
+    ++f.stamp;
+    f.touched.clear();
+    f.gone.clear();
+    f.inserts.clear();
+    for (; enter < size_t(n) && f.active[enter].y0 <= y; ++enter) {
+        int e = int(enter);
+        // Where the contour goes on downwards from the end of an edge, the
+        // new edge takes the old one's place.
+        const BZfillEdge& E = f.active[e];
+        int o = f.activeOf[E.dir > 0 ? f.prev[E.id] : f.next[E.id]];
+        if (o >= 0 && f.left[o] >= 0 && f.active[o].y1 == y) {
+            fillLink(f, f.left[o], e);
+            fillLink(f, e, f.right[o]);
+            f.left[o] = f.right[o] = -1;
+            f.wind[e] = f.wind[o];
+            f.gone.push_back(o);
+            fillTouch(f, e);
+        }
+        else
+            f.inserts.push_back(e);
+    }
+    for (; leave < f.byEnd.size() && f.active[f.byEnd[leave]].y1 <= y; ++leave) {
+        int o = f.byEnd[leave];
+        if (f.left[o] < 0) continue;
+        int l = f.left[o], r = f.right[o];
+        fillLink(f, l, r);
+        f.left[o] = f.right[o] = -1;
+        f.gone.push_back(o);
+        fillTouch(f, l);
+        fillTouch(f, r);
+    }
+    if (!f.inserts.empty()) {
+        std::sort(f.inserts.begin(), f.inserts.end(), [&](int a, int b) { return fillBefore(f, a, b, y); });
+        int at = f.right[head];
+        for (int e : f.inserts) {
+            while (at != tail && fillBefore(f, at, e, y))
+                at = f.right[at];
+            fillLink(f, f.left[at], e);
+            fillLink(f, e, at);
+            fillTouch(f, e);
+        }
+    }
+    fillSettle(f, y);
+}
+
+// Sweeps the edges overlapping the y window [top, bot], adding the
+// trapezoids found there.
+inline void fillSweep(BZfill& f, float top, float bot) {
+    f.winTop = top;
+    f.winBot = bot;
+    f.active.clear();
+    f.ys.clear();
+    // f.edges come sorted by y0 already.
+    for (const BZfillEdge& e : f.edges) {
+        if (e.y0 >= bot) break;
+        if (e.y1 > top && e.dir != 0)
+            f.active.push_back(e);
+    }
+    int n = int(f.active.size()), head = n, tail = n + 1;
+    if (n == 0) return;
+    for (const BZfillEdge& e : f.active) {
+        if (e.y0 > top) f.ys.push_back(e.y0);
+        if (e.y1 < bot) f.ys.push_back(e.y1);
+    }
+    std::sort(f.ys.begin(), f.ys.end());
+    f.ys.erase(std::unique(f.ys.begin(), f.ys.end()), f.ys.end());
+    f.keys.clear();
+    for (int e = 0; e < n; ++e) {
+        if (f.active[e].y1 < bot)
+            f.keys.push_back({ f.active[e].y1, e });
+        f.activeOf[f.active[e].id] = e;
+    }
+    std::sort(f.keys.begin(), f.keys.end());
+    f.byEnd.clear();
+    for (const auto& k : f.keys)
+        f.byEnd.push_back(k.second);
+    f.left.assign(n + 2, -1);
+    f.right.assign(n + 2, -1);
+    f.wind.assign(n + 2, 0);
+    f.openRight.assign(n + 2, -1);
+    f.openY.resize(n + 2);
+    f.bound.assign(n + 2, 0);
+    f.mark.assign(n + 2, 0);
+    f.runMark.assign(n + 2, 0);
+    f.runRight.resize(n + 2);
+    f.stamp = f.runStamp = 0;
+    f.crossings.clear();
+
+    // The edges crossing the window's top, sorted once.
+    size_t enter = 0, leave = 0;
+    f.keys.clear();
+    for (; enter < size_t(n) && f.active[enter].y0 <= top; ++enter)
+        f.keys.push_back({ fillEdgeX(f.active[enter], top), int(enter) });
+    std::sort(f.keys.begin(), f.keys.end(), [&](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+        return a.first < b.first || (a.first == b.first && f.active[a.second].dxdy < f.active[b.second].dxdy);
+    });
+    int at = head, w = 0;
+    for (const auto& k : f.keys) {
+        int e = k.second;
+        fillLink(f, at, e);
+        w += f.active[e].dir;
+        f.wind[e] = w;
+        at = e;
+    }
+    fillLink(f, at, tail);
+    if (at != head) {
+        fillRuns(f, f.right[head], at, top);
+        for (int e = f.right[head]; f.right[e] != tail; e = f.right[e])
+            fillCheckCross(f, e, f.right[e], top);
+    }
+
+    for (size_t k = 0; ; ) {
+        float y = k < f.ys.size() ? f.ys[k] : bot;
+        if (!f.crossings.empty() && f.crossings.front().y <= y && f.crossings.front().y < bot) {
+            BZfillCross c = f.crossings.front();
+            std::pop_heap(f.crossings.begin(), f.crossings.end(), fillLater);
+            f.crossings.pop_back();
+            if (f.right[c.l] != c.r) continue;
+            ++f.stamp;
+            f.touched.clear();
+            f.gone.clear();
+            int l = f.left[c.l], r = f.right[c.r];
+            fillLink(f, l, c.r);
+            fillLink(f, c.r, c.l);
+            fillLink(f, c.l, r);
+            fillTouch(f, c.r);
+            fillTouch(f, c.l);
+            fillSettle(f, c.y);
+            continue;
+        }
+        if (k == f.ys.size()) break;
+        fillLevel(f, y, enter, leave);
+        ++k;
+    }
+    // Whatever is still open ends at the bottom.
+    for (int e = f.right[head]; e != tail; e = f.right[e])
+        if (f.openRight[e] >= 0)
+            fillEmit(f, e, bot);
+    for (const BZfillEdge& e : f.active)
+        f.activeOf[e.id] = -1;
+}
+
+// Keeps s for the sweep to continue; a second piece with the same left
+// edge at the same height can only come from degenerate input and is
+// kept as it is.
+inline void fillAddStub(BZfill& f, std::vector<int>& index, const BZfillTrap& s) {
+    if (index[s.left] < 0)
+        index[s.left] = int(f.stubs.size());
+    f.stubs.push_back(s);
+}
+
+// Triangulates the contours stored back to back in p, contour k ending
+// before ends[k]. Returns the vertex count of f.tris.
+inline int fillBuild(BZfill& f, const BZpoint* p, const int* ends, int contours, FillRule rule) {
+    int n = contours > 0 ? ends[contours - 1] : 0;
+    f.rule = rule;
+    f.pts.assign(p, p + n);
+    f.next.resize(n);
+    f.prev.resize(n);
+    int first = 0;
+    for (int c = 0; c < contours; ++c) {
+        for (int i = first; i < ends[c]; ++i) {
+            f.next[i] = i + 1 < ends[c] ? i + 1 : first;
+            f.prev[f.next[i]] = i;
+        }
+        first = ends[c];
+    }
+
+    float lo = FLT_MAX, hi = -FLT_MAX;
+    for (int i = 0; i < n; ++i) {
+        lo = std::min(lo, p[i].y);
+        hi = std::max(hi, p[i].y);
+    }
+    f.edges.resize(n);
+    for (int i = 0; i < n; ++i)
+        fillEdge(f, i, f.edges[i]);
+    std::sort(f.edges.begin(), f.edges.end(), fillAbove);
+    f.traps.clear();
+    f.tris.clear();
+    f.stubs.clear();
+    f.activeOf.assign(n, -1);
+    f.stubTop.assign(n, -1);
+    f.stubBot.assign(n, -1);
+    if (lo < hi)
+        fillSweep(f, lo, hi);
+    return int(f.tris.size());
+}
+
+// Re-triangulates after points lo..hi of the last fillBuild() moved to
+// their positions in p; the contours must be unchanged otherwise.
+inline int fillUpdate(BZfill& f, const BZpoint* p, int lo, int hi) {
+    if (f.pts.empty() || lo > hi) return int(f.tris.size());
+    // The window spans every edge touching the range, old and new.
+    float top = FLT_MAX, bot = -FLT_MAX;
+    auto extend = [&](float y) {
+        top = std::min(top, y);
+        bot = std::max(bot, y);
+    };
+    for (int i = lo; i <= hi; ++i) {
+        extend(f.pts[i].y);
+        extend(p[i].y);
+        extend(f.pts[f.prev[i]].y);
+        extend(f.pts[f.next[i]].y);
+    }
+    std::copy(p + lo, p + hi + 1, f.pts.begin() + lo);
+    // Only the moved edges are out of order; insertion sort puts them back
+    // in about the time it takes to walk the list.
+    for (size_t k = 0; k < f.edges.size(); ++k) {
+        int i = f.edges[k].id, j = f.next[i];
+        if ((i >= lo && i <= hi) || (j >= lo && j <= hi))
+            fillEdge(f, i, f.edges[k]);
+    }
+    for (size_t k = 1; k < f.edges.size(); ++k) {
+        BZfillEdge e = f.edges[k];
+        size_t j = k;
+        for (; j > 0 && fillAbove(e, f.edges[j - 1]); --j)
+            f.edges[j] = f.edges[j - 1];
+        f.edges[j] = e;
+    }
+    // Horizontal edges bound no trapezoid.
+    if (!(top < bot)) return int(f.tris.size());
+
+    // Trapezoids overlapping the window are dropped. Their parts above and
+    // below it become stubs, as do trapezoids ending or starting right at
+    // it, so that the sweep can extend them; the rest are kept in place.
+    f.stubs.clear();
+    size_t keep = 0;
+    for (size_t k = 0; k < f.traps.size(); ++k) {
+        BZfillTrap t = f.traps[k];
+        bool cut = t.y0 < bot && t.y1 > top;
+        bool atTop = cut ? t.y0 < top : t.y1 == top;
+        bool atBot = cut ? t.y1 > bot : t.y0 == bot;
+        if (!cut && !atTop && !atBot) {
+            if (keep != k) {
+                f.traps[keep] = t;
+                std::copy(f.tris.begin() + k * 6, f.tris.begin() + k * 6 + 6, f.tris.begin() + keep * 6);
+            }
+            ++keep;
+            continue;
+        }
+        if (atTop)
+            fillAddStub(f, f.stubTop, { t.left, t.right, t.y0, std::min(t.y1, top) });
+        if (atBot)
+            fillAddStub(f, f.stubBot, { t.left, t.right, std::max(t.y0, bot), t.y1 });
+    }
+    f.traps.resize(keep);
+    f.tris.resize(keep * 6);
+    fillSweep(f, top, bot);
+    for (const BZfillTrap& s : f.stubs) {
+        BZfillEdge a, b;
+        if (s.right >= 0 && fillEdge(f, s.left, a) && fillEdge(f, s.right, b))
+            fillAddTrap(f, a, b, s.y0, s.y1);
+        f.stubTop[s.left] = f.stubBot[s.left] = -1;
+    }
+    return int(f.tris.size());
+}
@@ -0,0 +1,497 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "bezier.h"
+
+// Streaming fit of freehand input to cubic Beziers, after Schneider's
+// "An Algorithm for Automatically Fitting Digitized Curves" (Graphics Gems,
+// 1990): least-squares handle lengths for fixed end tangents, chord-length
+// parameters refined by Newton steps, and a split wherever one cubic no
+// longer fits.
+//
+// The split is found incrementally instead of by recursion. The fitter
+// holds the samples since the last committed point and refits them per
+// sample. While that fits within tol the run grows; once it does not, the
+// previous fit, which ended one sample back, is kept and the run restarts
+// there. A run is also cut when it reaches maxSamples, which bounds both
+// the latency and the cost per sample.
+//
+// The cubics join C1. A cubic that stopped growing is not committed at
+// once but kept pending, and the samples after it are fitted together
+// with it: one least-squares length is shared by its end handle and the
+// next cubic's first handle, and the join itself is solved for rather than
+// pinned to a sample, so pixel steps do not bend the tangent. The pending
+// cubic is committed once the next one stops growing in turn. The join
+// becomes a corner only where the samples leave it at more than
+// FIT_CORNER_ANGLE from the incoming tangent. If nothing joins it within
+// maxSamples, the pending cubic is committed with its end handle as short
+// as tol allows and the next run starts with that handle mirrored; only if
+// even that does not fit does the join keep just the tangent.
+
+const float FIT_MIN_STEP = 0.25f;     // samples closer than this * tol to the last one are dropped
+const int FIT_MAX_SAMPLES = 96;       // longest run before it is cut anyway
+const float FIT_CORNER_ANGLE = 0.7854f;   // radians between incoming tangent and samples at a corner
+const float FIT_CORNER_REACH = 8;     // samples this many tol from the join give its direction
+const float FIT_TANGENT_REACH = 6;    // tangents span samples this many tol apart
+const int FIT_SHORTEN_STEPS = 6;      // bisections of a dropped cubic's end handle
+const int FIT_NEWTON_STEPS = 4;
+
+struct BZfitter {
+    float tol = 0.002f;                // max distance of a sample from its cubic
+    int maxSamples = FIT_MAX_SAMPLES;
+    std::vector<BZpoint> run;          // samples since the last committed point, which is run[0]
+    int mid = 0;                       // end of the pending cubic in run; 0 while there is none
+    BZpoint handle = { 0, 0 };         // first handle of the run's first cubic; zero leaves it free
+    bool loose = false;                // whether that handle keeps only its direction
+    int fitted = 0;                    // samples of the run cur fits
+    bool turnChecked = false;          // whether the join at run[mid] was tested for a corner
+    bool overshoot = false;            // whether the last fit failed on a handle longer than its chord
+    BZpoint pend[4];                   // pending cubic as last fitted
+    BZpoint cur[7];                    // last fit that met tol: the pending cubic, then the one after it
+    std::vector<BZpoint> segs;         // committed cubics: 3k + 1 points, ends shared
+    std::vector<float> u, v;           // parameters of the pending and the following samples
+    long long samples = 0;             // handed to fitAdd since fitBegin
+    int longestRun = 0;
+};
+
+inline BZpoint fitUnit(BZpoint v) {
+    float l = std::sqrt(v.x * v.x + v.y * v.y);
+    return l > 0 ? v.mult(1 / l) : BZpoint{ 0, 0 };
+}
+
+inline float fitDot(BZpoint a, BZpoint b) {
+    return a.x * b.x + a.y * b.y;
+}
+
+inline BZpoint fitEval(const BZpoint* c, float t) {
+    float s = 1 - t;
+    float b0 = s * s * s, b1 = 3 * s * s * t, b2 = 3 * s * t * t, b3 = t * t * t;
+    return { b0 * c[0].x + b1 * c[1].x + b2 * c[2].x + b3 * c[3].x,
+             b0 * c[0].y + b1 * c[1].y + b2 * c[2].y + b3 * c[3].y };
+}
+
+// Largest squared distance of the samples from c at their parameters.
+inline float fitError(const BZpoint* d, int n, const float* u, const BZpoint* c) {
+    float worst = 0;
+    for (int i = 1; i < n - 1; ++i) {
+        BZpoint q = fitEval(c, u[i]);
+        float dx = q.x - d[i].x, dy = q.y - d[i].y;
+        worst = std::max(worst, dx * dx + dy * dy);
+    }
+    return worst;
+}
+
+// Handle lengths by least squares for end tangents t1 (leaving d[0]) and
+// t2 (leaving d[n-1] backwards), with Schneider's fallback to a third of
+// the chord when the system is singular or a handle would point backwards
+// or overshoot the chord. al > 0 fixes the first handle's length and only
+// the second is solved.
+inline void fitHandles(const BZpoint* d, int n, const float* u, BZpoint t1, BZpoint t2, float al, BZpoint* c) {
+    BZpoint p0 = d[0], p3 = d[n - 1];
+    float c00 = 0, c01 = 0, c11 = 0, x0 = 0, x1 = 0;
+    for (int i = 0; i < n; ++i) {
+        float t = u[i], s = 1 - t;
+        float b0 = s * s * s, b1 = 3 * s * s * t, b2 = 3 * s * t * t, b3 = t * t * t;
+        BZpoint a1 = t1.mult(b1), a2 = t2.mult(b2);
+        c00 += fitDot(a1, a1);
+        c01 += fitDot(a1, a2);
+        c11 += fitDot(a2, a2);
+        BZpoint r = { d[i].x - (b0 + b1) * p0.x - (b2 + b3) * p3.x, d[i].y - (b0 + b1) * p0.y - (b2 + b3) * p3.y };
+        x0 += fitDot(a1, r);
+        x1 += fitDot(a2, r);
+    }
+    float det = c00 * c11 - c01 * c01;
+    float chord = std::sqrt(fitDot(p3.add(p0.mult(-1)), p3.add(p0.mult(-1))));
+    float eps = 1e-6f * chord;
+    float ar = 0;
+    if (al > 0) {
+        if (c11 > 1e-12f) ar = (x1 - c01 * al) / c11;
+        if (!(ar > eps) || ar > chord) ar = chord / 3;
+    }
+    else {
+        if (std::fabs(det) > 1e-12f) {
+            al = (x0 * c11 - x1 * c01) / det;
+            ar = (c00 * x1 - c01 * x0) / det;
+        }
+        if (!(al > eps) || !(ar > eps) || al > chord || ar > chord)
+            al = ar = chord / 3;
+    }
+    c[0] = p0;
+    c[1] = p0.add(t1.mult(al));
+    c[2] = p3.add(t2.mult(ar));
+    c[3] = p3;
+}
+
+// One Newton step per sample towards the closest point of c.
+inline void fitReparam(const BZpoint* d, int n, float* u, const BZpoint* c) {
+    BZpoint d1[3] = { c[1].add(c[0].mult(-1)).mult(3), c[2].add(c[1].mult(-1)).mult(3), c[3].add(c[2].mult(-1)).mult(3) };
+    BZpoint d2[2] = { d1[1].add(d1[0].mult(-1)).mult(2), d1[2].add(d1[1].mult(-1)).mult(2) };
+    for (int i = 1; i < n - 1; ++i) {
+        float t = u[i], s = 1 - t;
+        BZpoint q = fitEval(c, t).add(d[i].mult(-1));
+        BZpoint q1 = d1[0].mult(s * s).add(d1[1].mult(2 * s * t)).add(d1[2].mult(t * t));
+        BZpoint q2 = d2[0].mult(s).add(d2[1].mult(t));
+        float den = fitDot(q1, q1) + fitDot(q, q2);
+        if (den != 0)
+            u[i] = std::min(std::max(t - fitDot(q, q1) / den, 0.0f), 1.0f);
+    }
+}
+
+// Chord-length parameters of d[0..n) in [0, 1].
+inline void fitChordParams(const BZpoint* d, int n, float* u) {
+    u[0] = 0;
+    for (int i = 1; i < n; ++i) {
+        BZpoint e = d[i].add(d[i - 1].mult(-1));
+        u[i] = u[i - 1] + std::sqrt(fitDot(e, e));
+    }
+    float total = u[n - 1];
+    for (int i = 1; i < n; ++i)
+        u[i] = total > 0 ? u[i] / total : float(i) / (n - 1);
+}
+
+// Fits one cubic to d[0..n) with the given end tangents, and the first
+// handle's length if al > 0; returns the squared error. u must hold n
+// floats.
+inline float fitCubic(const BZpoint* d, int n, BZpoint t1, BZpoint t2, float al, float tol, BZpoint* c, float* u) {
+    fitChordParams(d, n, u);
+    fitHandles(d, n, u, t1, t2, al, c);
+    float err = fitError(d, n, u, c);
+    // Newton steps only pay off when the fit is already close.
+    for (int k = 0; k < FIT_NEWTON_STEPS && err > tol * tol && err < 16 * tol * tol; ++k) {
+        fitReparam(d, n, u, c);
+        fitHandles(d, n, u, t1, t2, al, c);
+        err = fitError(d, n, u, c);
+    }
+    return err;
+}
+
+// Tangent leaving d[i] backwards, through the nearest samples at least
+// reach away on each side, or the farthest there are.
+inline BZpoint fitTangentAt(const BZpoint* d, int n, int i, float reach) {
+    int a = i, b = i;
+    auto near = [&](int j) {
+        BZpoint e = d[j].add(d[i].mult(-1));
+        return fitDot(e, e) < reach * reach;
+    };
+    while (a > 0 && (a == i || near(a))) --a;
+    while (b < n - 1 && (b == i || near(b))) ++b;
+    return fitUnit(d[a].add(d[b].mult(-1)));
+}
+
+// Solves the k x k system a x = r in place, k <= 4, by Gaussian
+// elimination with partial pivoting; false if it is singular.
+inline bool fitSolve(float a[4][4], float* r, int k) {
+    for (int i = 0; i < k; ++i) {
+        int p = i;
+        for (int j = i + 1; j < k; ++j)
+            if (std::fabs(a[j][i]) > std::fabs(a[p][i])) p = j;
+        if (!(std::fabs(a[p][i]) > 1e-12f)) return false;
+        std::swap(a[i], a[p]);
+        std::swap(r[i], r[p]);
+        for (int j = i + 1; j < k; ++j) {
+            float q = a[j][i] / a[i][i];
+            for (int l = i; l < k; ++l) a[j][l] -= q * a[i][l];
+            r[j] -= q * r[i];
+        }
+    }
+    for (int i = k - 1; i >= 0; --i) {
+        for (int l = i + 1; l < k; ++l) r[i] -= a[i][l] * r[l];
+        r[i] /= a[i][i];
+    }
+    return true;
+}
+
+// Fits the pending cubic to run[0..mid] and the next one to run[mid..n).
+// The pending cubic keeps its first handle; the handles at the join share
+// one length along the tangent there. That length, the next cubic's last
+// handle and the join itself, which only has to lie within tol of
+// run[mid], are solved by least squares over both cubics. The fit replaces
+// f.cur unless either cubic misses tol.
+inline bool fitJoint(BZfitter& f, int n) {
+    const BZpoint* d = f.run.data();
+    int m = f.mid, nb = n - m;
+    float* u = f.u.data();
+    float* v = f.v.data();
+    BZpoint p0 = d[0], pn = d[n - 1], c1 = p0.add(f.handle);
+    BZpoint t = fitTangentAt(d, n, m, FIT_TANGENT_REACH * f.tol).mult(-1);
+    BZpoint tn = fitTangentAt(d, n, n - 1, FIT_TANGENT_REACH * f.tol);
+    fitChordParams(d, m + 1, u);
+    fitChordParams(d + m, nb, v);
+    BZpoint c[7];
+    float err = 0;
+    for (int k = 0;; ++k) {
+        // Unknowns: the join's x and y, the shared length, the last handle.
+        // A sample pulls on the join through weight q, on the shared
+        // length along g and on the last handle along l.
+        float a[4][4] = {}, x[4] = {};
+        auto add = [&](float q, BZpoint g, BZpoint l, BZpoint r) {
+            a[0][0] += q * q;
+            a[0][2] += q * g.x;
+            a[1][2] += q * g.y;
+            a[0][3] += q * l.x;
+            a[1][3] += q * l.y;
+            a[2][2] += fitDot(g, g);
+            a[2][3] += fitDot(g, l);
+            a[3][3] += fitDot(l, l);
+            x[0] += q * r.x;
+            x[1] += q * r.y;
+            x[2] += fitDot(g, r);
+            x[3] += fitDot(l, r);
+        };
+        for (int i = 0; i <= m; ++i) {
+            float w = u[i], s = 1 - w;
+            float b0 = s * s * s, b1 = 3 * s * s * w, b2 = 3 * s * w * w, b3 = w * w * w;
+            add(b2 + b3, t.mult(-b2), { 0, 0 }, d[i].add(p0.mult(-b0)).add(c1.mult(-b1)));
+        }
+        for (int j = 0; j < nb; ++j) {
+            float w = v[j], s = 1 - w;
+            float b0 = s * s * s, b1 = 3 * s * s * w, b2 = 3 * s * w * w, b3 = w * w * w;
+            add(b0 + b1, t.mult(b1), tn.mult(b2), d[m + j].add(pn.mult(-(b2 + b3))));
+        }
+        a[1][1] = a[0][0];
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < i; ++j) a[i][j] = a[j][i];
+        // Without samples inside the next cubic its last handle is free.
+        bool free = !(a[3][3] > 1e-12f);
+        if (!fitSolve(a, x, free ? 3 : 4)) return false;
+        BZpoint pm = { x[0], x[1] };
+        BZpoint ep = pm.add(p0.mult(-1)), eb = pn.add(pm.mult(-1));
+        float chordP = std::sqrt(fitDot(ep, ep)), chordB = std::sqrt(fitDot(eb, eb));
+        float h = x[2], b = free ? 0 : x[3];
+        if (!(b > 1e-6f * chordB)) b = chordB / 3;
+        if (!(h > 1e-6f * chordB)) h = std::min(chordP, chordB) / 3;
+        // A handle longer than its chord overshoots that cubic's end.
+        if (h > chordP || h > chordB) {
+            f.overshoot = true;
+            return false;
+        }
+        c[0] = p0;
+        c[1] = c1;
+        c[2] = pm.add(t.mult(-h));
+        c[3] = pm;
+        c[4] = pm.add(t.mult(h));
+        c[5] = pn.add(tn.mult(b));
+        c[6] = pn;
+        BZpoint e = pm.add(d[m].mult(-1));
+        err = std::max(std::max(fitError(d, m + 1, u, c), fitError(d + m, nb, v, c + 3)), fitDot(e, e));
+        if (k == FIT_NEWTON_STEPS || err <= f.tol * f.tol || err >= 16 * f.tol * f.tol) break;
+        fitReparam(d, m + 1, u, c);
+        fitReparam(d + m, nb, v, c + 3);
+    }
+    if (err > f.tol * f.tol) return false;
+    std::copy(c, c + 7, f.cur);
+    return true;
+}
+
+// Fits the first n samples of the run; false if that misses tol, else the
+// fit replaces f.cur. Without a pending cubic one cubic, in cur[3..6],
+// starts with f.handle, or only along it if f.loose, or freely if it is
+// zero.
+inline bool fitRun(BZfitter& f, int n) {
+    if (int(f.u.size()) < n) {
+        f.u.resize(std::max(n, 2 * f.maxSamples + 2));
+        f.v.resize(f.u.size());
+    }
+    f.overshoot = false;
+    if (f.mid > 0) return fitJoint(f, n);
+    const BZpoint* d = f.run.data();
+    BZpoint t1 = fitUnit(f.handle);
+    float al = 0;
+    if (t1.x == 0 && t1.y == 0)
+        t1 = fitTangentAt(d, n, 0, FIT_TANGENT_REACH * f.tol).mult(-1);
+    else if (!f.loose) {
+        // A handle longer than the chord overshoots the run's end.
+        al = std::sqrt(fitDot(f.handle, f.handle));
+        BZpoint chord = d[n - 1].add(d[0].mult(-1));
+        if (fitDot(chord, chord) < al * al) {
+            f.overshoot = true;
+            return false;
+        }
+    }
+    BZpoint t2 = fitTangentAt(d, n, n - 1, FIT_TANGENT_REACH * f.tol);
+    BZpoint c[4];
+    if (fitCubic(d, n, t1, t2, al, f.tol, c, f.u.data()) > f.tol * f.tol) return false;
+    std::copy(c, c + 4, f.cur + 3);
+    return true;
+}
+
+// Whether the samples leave run[mid] too far from the pending cubic's end
+// tangent to join it smoothly; false until they are far enough to tell.
+inline bool fitCorner(BZfitter& f) {
+    if (f.turnChecked) return false;
+    BZpoint pm = f.run[f.mid], in = fitUnit(f.pend[3].add(f.pend[2].mult(-1)));
+    for (size_t i = f.mid + 1; i < f.run.size(); ++i) {
+        BZpoint e = f.run[i].add(pm.mult(-1));
+        if (fitDot(e, e) < FIT_CORNER_REACH * FIT_CORNER_REACH * f.tol * f.tol) continue;
+        f.turnChecked = true;
+        return fitDot(fitUnit(e), in) < std::cos(FIT_CORNER_ANGLE);
+    }
+    return false;
+}
+
+// Appends c, which fits k samples, to the committed cubics.
+inline void fitEmit(BZfitter& f, const BZpoint* c, int k) {
+    if (f.segs.empty()) f.segs.push_back(c[0]);
+    f.segs.insert(f.segs.end(), c + 1, c + 4);
+    f.longestRun = std::max(f.longestRun, k);
+}
+
+// Makes the last cubic of f.cur, which ends at run[fitted - 1], the pending
+// one, committing the cubic pending before it; returns the number committed.
+inline int fitAdvance(BZfitter& f) {
+    int added = 0;
+    if (f.mid > 0) {
+        fitEmit(f, f.cur, f.mid + 1);
+        f.run.erase(f.run.begin(), f.run.begin() + f.mid);
+        f.run[0] = f.cur[3];
+        f.fitted -= f.mid;
+        added = 1;
+    }
+    std::copy(f.cur + 3, f.cur + 7, f.pend);
+    f.handle = f.pend[1].add(f.pend[0].mult(-1));
+    f.mid = f.fitted - 1;
+    f.loose = false;
+    f.turnChecked = false;
+    return added;
+}
+
+// Squared error of the fixed cubic c over d[0..n), with the parameters
+// refined as in fitCubic. u must hold n floats.
+inline float fitCheck(const BZpoint* d, int n, float tol, const BZpoint* c, float* u) {
+    fitChordParams(d, n, u);
+    float err = fitError(d, n, u, c);
+    for (int k = 0; k < FIT_NEWTON_STEPS && err > tol * tol && err < 16 * tol * tol; ++k) {
+        fitReparam(d, n, u, c);
+        err = fitError(d, n, u, c);
+    }
+    return err;
+}
+
+// Shortens the end handle of the pending cubic as far as it still fits,
+// which leaves the most room to the cubic that mirrors it.
+inline void fitShorten(BZfitter& f) {
+    BZpoint c[4] = { f.pend[0], f.pend[1], f.pend[2], f.pend[3] };
+    BZpoint h = f.pend[2].add(f.pend[3].mult(-1));
+    float lo = 0, hi = 1;
+    for (int k = 0; k < FIT_SHORTEN_STEPS; ++k) {
+        float s = (lo + hi) / 2;
+        c[2] = f.pend[3].add(h.mult(s));
+        if (fitCheck(f.run.data(), f.mid + 1, f.tol, c, f.u.data()) <= f.tol * f.tol) hi = s;
+        else lo = s;
+    }
+    f.pend[2] = f.pend[3].add(h.mult(hi));
+}
+
+// Commits the pending cubic as last fitted when nothing after it joins it.
+// The samples after it start over with its end handle mirrored, or freely
+// at a corner.
+inline void fitDrop(BZfitter& f, bool corner) {
+    if (!corner) fitShorten(f);
+    fitEmit(f, f.pend, f.mid + 1);
+    f.run.erase(f.run.begin(), f.run.begin() + f.mid);
+    f.run[0] = f.pend[3];
+    f.handle = corner ? BZpoint{ 0, 0 } : f.pend[3].add(f.pend[2].mult(-1));
+    f.loose = false;
+    f.mid = 0;
+    f.fitted = 0;
+    f.turnChecked = false;
+}
+
+// Fits the samples the run holds after it changed, advancing while they
+// do not all fit; returns the number of cubics committed.
+inline int fitSettle(BZfitter& f) {
+    int added = 0;
+    for (;;) {
+        int n = int(f.run.size()), k = n;
+        while (k - f.mid >= 2 && !fitRun(f, k)) --k;
+        if (k == n) {
+            f.fitted = n;
+            return added;
+        }
+        if (k - f.mid >= 2) {
+            f.fitted = k;
+            added += fitAdvance(f);
+            continue;
+        }
+        f.fitted = f.mid + 1;
+        if (f.mid == 0) {
+            // Nothing takes the mirrored handle yet; unless the samples are
+            // just too short for it, the join keeps only its tangent.
+            if (f.overshoot && n < f.maxSamples) return added;
+            f.loose = true;
+            continue;
+        }
+        // Nothing after the pending cubic joins it yet; more samples may.
+        bool corner = fitCorner(f);
+        if (!corner && n - f.mid < f.maxSamples) return added;
+        fitDrop(f, corner);
+        ++added;
+    }
+}
+
+inline void fitBegin(BZfitter& f, BZpoint p) {
+    f.run.assign(1, p);
+    f.mid = 0;
+    f.handle = { 0, 0 };
+    f.loose = false;
+    f.fitted = 1;
+    f.turnChecked = false;
+    f.segs.clear();
+    f.samples = 1;
+    f.longestRun = 0;
+}
+
+// Adds a sample; returns the number of cubics committed, which are the
+// last ones in f.segs.
+inline int fitAdd(BZfitter& f, BZpoint p) {
+    ++f.samples;
+    BZpoint e = p.add(f.run.back().mult(-1));
+    if (fitDot(e, e) < FIT_MIN_STEP * FIT_MIN_STEP * f.tol * f.tol) return 0;
+    f.run.push_back(p);
+    int n = int(f.run.size());
+    if (fitRun(f, n)) {
+        f.fitted = n;
+        return n - f.mid < f.maxSamples ? 0 : fitAdvance(f);
+    }
+    if (f.fitted - f.mid >= 2) {
+        // The run up to the previous sample fitted; keep that fit.
+        int added = fitAdvance(f);
+        return added + fitSettle(f);
+    }
+    if (f.mid == 0) {
+        // Nothing takes the mirrored handle yet.
+        if (f.overshoot && n < f.maxSamples) return 0;
+        f.loose = true;
+        return fitSettle(f);
+    }
+    // Nothing after the pending cubic joins it yet; more samples may.
+    bool corner = fitCorner(f);
+    if (!corner && n - f.mid < f.maxSamples) return 0;
+    fitDrop(f, corner);
+    return 1 + fitSettle(f);
+}
+
+// Commits what is left of the run; returns the number of cubics added.
+inline int fitEnd(BZfitter& f) {
+    int added = 0;
+    while (int(f.run.size()) - f.mid >= 2) {
+        if (f.fitted == int(f.run.size()))
+            added += fitAdvance(f);
+        else if (f.mid == 0) {
+            f.loose = true;
+            added += fitSettle(f);
+        }
+        else {
+            fitDrop(f, fitCorner(f));
+            added += 1 + fitSettle(f);
+        }
+    }
+    if (f.mid > 0) {
+        fitEmit(f, f.pend, f.mid + 1);
+        f.run.erase(f.run.begin(), f.run.begin() + f.mid);
+        f.mid = 0;
+        ++added;
+    }
+    return added;
+}
@@ -0,0 +1,431 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include "bezier.h"
+#include "tessellate.h"
+#include "raster.h"
+
+// TrueType fonts. A glyph outline is a set of closed contours of quadratic
+// Beziers, which go through the same adaptive tessellator as every other
+// curve and are then rasterized with raster.h (nonzero rule, as TrueType
+// requires). Only glyf outlines are read: CFF-based OpenType fonts and
+// font collections are rejected, hinting is ignored and there is no
+// kerning. Reads are bounds-checked against the file and each glyph's own
+// bytes, and glyphs bigger than the head table's bounds are dropped, so a
+// corrupt font yields empty glyphs instead of huge ones or reads past the
+// file.
+
+const uint32_t FONT_MAX_COMPOSITE_DEPTH = 8;
+const int GLYPH_SEG_MAX = 64;   // vertices per flattened quadratic
+
+#ifdef _WIN32
+const char* const FONT_DEFAULT_PATHS[] = { "C:/Windows/Fonts/arial.ttf", "C:/Windows/Fonts/segoeui.ttf" };
+#else
+const char* const FONT_DEFAULT_PATHS[] = { "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/TTF/DejaVuSans.ttf", "/Library/Fonts/Arial.ttf" };
+#endif
+
+struct BZfont {
+    std::vector<uint8_t> data;
+    uint32_t glyf = 0, loca = 0, hmtx = 0, cmap = 0;   // table offsets; cmap is the chosen subtable
+    int cmapFormat = 0;
+    int unitsPerEm = 1000;
+    int glyphCount = 0;
+    int hmetricCount = 0;
+    bool locaLong = false;
+    int ascent = 0, descent = 0, lineGap = 0;          // font units, descent negative
+    int xMin = 0, yMin = 0, xMax = 0, yMax = 0;        // bounds of every glyph
+};
+
+// Contours of quadratic segments in font units, y up. Contour k is the
+// points [ends[k - 1], ends[k]) as start, ctrl, end, ctrl, end, ...; its
+// last point repeats the first. Straight edges get their midpoint as the
+// control point.
+struct BZglyphOutline {
+    std::vector<BZpoint> pts;
+    std::vector<int> ends;
+};
+
+// A rasterized glyph: w x h coverage bytes, placed with its top-left
+// corner at (bearingX, bearingY) pixels from the pen on the baseline, y
+// down.
+struct BZglyphBitmap {
+    int w = 0, h = 0;
+    int bearingX = 0, bearingY = 0;
+    std::vector<uint8_t> cov;
+};
+
+struct BZglyphScratch {
+    BZglyphOutline outline;
+    std::vector<BZpoint> poly;
+    BZscratch s;
+    BZpool pool;
+    BZrasterizer r;
+    std::vector<BZrasterLayer> layers = std::vector<BZrasterLayer>(1);
+    BZimage img;
+};
+
+inline uint32_t fontU8(const BZfont& f, size_t at) {
+    return at < f.data.size() ? f.data[at] : 0;
+}
+
+inline uint32_t fontU16(const BZfont& f, size_t at) {
+    return at + 2 <= f.data.size() ? uint32_t(f.data[at]) << 8 | f.data[at + 1] : 0;
+}
+
+inline int fontI16(const BZfont& f, size_t at) {
+    return int16_t(fontU16(f, at));
+}
+
+inline uint32_t fontU32(const BZfont& f, size_t at) {
+    return fontU16(f, at) << 16 | fontU16(f, at + 2);
+}
+
+inline uint32_t fontTable(const BZfont& f, const char* tag) {
+    int tables = int(fontU16(f, 4));
+    for (int i = 0; i < tables; ++i) {
+        size_t rec = 12 + size_t(i) * 16;
+        if (rec + 16 <= f.data.size() && memcmp(&f.data[rec], tag, 4) == 0)
+            return fontU32(f, rec + 8);
+    }
+    return 0;
+}
+
+// Picks a Unicode cmap subtable: full repertoire (format 12) first, then
+// the BMP (format 4).
+inline void fontPickCmap(BZfont& f, uint32_t cmap) {
+    int subtables = int(fontU16(f, cmap + 2));
+    for (int want : { 12, 4 })
+        for (int i = 0; i < subtables; ++i) {
+            size_t rec = cmap + 4 + size_t(i) * 8;
+            uint32_t platform = fontU16(f, rec), encoding = fontU16(f, rec + 2);
+            uint32_t sub = cmap + fontU32(f, rec + 4);
+            bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+            if (unicode && int(fontU16(f, sub)) == want) {
+                f.cmap = sub;
+                f.cmapFormat = want;
+                return;
+            }
+        }
+}
+
+inline bool fontLoad(const char* path, BZfont& f, std::string& err) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) { err = std::string("cannot open ") + path; return false; }
+    f = BZfont();
+    f.data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    uint32_t version = fontU32(f, 0);
+    if (version == 0x74746366) { err = "font collections are not supported"; return false; }   // 'ttcf'
+    if (version == 0x4F54544F) { err = "CFF outlines are not supported"; return false; }       // 'OTTO'
+    if (version != 0x00010000 && version != 0x74727565) { err = "not a TrueType font"; return false; }
+    uint32_t head = fontTable(f, "head"), maxp = fontTable(f, "maxp"), hhea = fontTable(f, "hhea");
+    uint32_t cmap = fontTable(f, "cmap");
+    f.glyf = fontTable(f, "glyf");
+    f.loca = fontTable(f, "loca");
+    f.hmtx = fontTable(f, "hmtx");
+    if (!head || !maxp || !hhea || !cmap || !f.glyf || !f.loca || !f.hmtx) {
+        err = "missing TrueType tables";
+        return false;
+    }
+    f.unitsPerEm = std::max(int(fontU16(f, head + 18)), 1);
+    f.xMin = fontI16(f, head + 36);
+    f.yMin = fontI16(f, head + 38);
+    f.xMax = fontI16(f, head + 40);
+    f.yMax = fontI16(f, head + 42);
+    f.locaLong = fontI16(f, head + 50) != 0;
+    f.glyphCount = int(fontU16(f, maxp + 4));
+    f.ascent = fontI16(f, hhea + 4);
+    f.descent = fontI16(f, hhea + 6);
+    f.lineGap = fontI16(f, hhea + 8);
+    f.hmetricCount = int(fontU16(f, hhea + 34));
+    fontPickCmap(f, cmap);
+    if (!f.cmapFormat) { err = "no Unicode character map"; return false; }
+    return true;
+}
+
+// Loads the first of FONT_DEFAULT_PATHS that works.
+inline bool fontLoadDefault(BZfont& f, std::string& err) {
+    for (const char* path : FONT_DEFAULT_PATHS)
+        if (fontLoad(path, f, err))
+            return true;
+    return false;
+}
+
+// Glyph index of a code point, 0 (the missing glyph) if there is none.
+inline int fontGlyph(const BZfont& f, uint32_t c) {
+    if (f.cmapFormat == 12) {
+        uint32_t groups = fontU32(f, f.cmap + 12);
+        uint32_t lo = 0, hi = groups;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            size_t g = f.cmap + 16 + size_t(mid) * 12;
+            if (c < fontU32(f, g)) hi = mid;
+            else if (c > fontU32(f, g + 4)) lo = mid + 1;
+            else return int(fontU32(f, g + 8) + (c - fontU32(f, g)));
+        }
+        return 0;
+    }
+    if (f.cmapFormat != 4 || c > 0xFFFF) return 0;
+    uint32_t segs = fontU16(f, f.cmap + 6) / 2;
+    size_t ends = f.cmap + 14, starts = ends + segs * 2 + 2;
+    size_t deltas = starts + segs * 2, ranges = deltas + segs * 2;
+    // First segment whose end code is >= c.
+    uint32_t lo = 0, hi = segs;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (fontU16(f, ends + mid * 2) < c) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == segs || c < fontU16(f, starts + lo * 2)) return 0;
+    uint32_t delta = fontU16(f, deltas + lo * 2), range = fontU16(f, ranges + lo * 2);
+    if (range == 0) return int((c + delta) & 0xFFFF);
+    uint32_t g = fontU16(f, ranges + lo * 2 + range + (c - fontU16(f, starts + lo * 2)) * 2);
+    return g ? int((g + delta) & 0xFFFF) : 0;
+}
+
+// Advance width in font units.
+inline int fontAdvance(const BZfont& f, int glyph) {
+    if (f.hmetricCount <= 0) return 0;
+    return int(fontU16(f, f.hmtx + size_t(std::min(glyph, f.hmetricCount - 1)) * 4));
+}
+
+// Byte range of a glyph in glyf; empty for blank glyphs such as space.
+inline void fontGlyphRange(const BZfont& f, int glyph, uint32_t& start, uint32_t& end) {
+    start = end = 0;
+    if (glyph < 0 || glyph >= f.glyphCount) return;
+    if (f.locaLong) {
+        start = fontU32(f, f.loca + size_t(glyph) * 4);
+        end = fontU32(f, f.loca + size_t(glyph) * 4 + 4);
+    }
+    else {
+        start = fontU16(f, f.loca + size_t(glyph) * 2) * 2;
+        end = fontU16(f, f.loca + size_t(glyph) * 2 + 2) * 2;
+    }
+    if (end <= start || f.glyf + size_t(end) > f.data.size()) start = end = 0;
+    start += f.glyf;
+    end += f.glyf;
+}
+
+// Appends one contour of on/off-curve points as quadratic segments;
+// consecutive off-curve points imply an on-curve point between them.
+inline void fontAddContour(BZglyphOutline& o, const BZpoint* p, const uint8_t* on, int n) {
+    if (n < 2) return;
+    auto mid = [](BZpoint a, BZpoint b) { return a.add(b).mult(0.5f); };
+    // Start on an on-curve point, or between the last and first points if
+    // all of them are off the curve.
+    int first = 0;
+    while (first < n && !on[first]) ++first;
+    BZpoint start = first < n ? p[first] : mid(p[n - 1], p[0]);
+    int rest = first < n ? n - 1 : n;
+    if (first == n) first = -1;
+    o.pts.push_back(start);
+    BZpoint last = start, ctrl = { 0, 0 };
+    bool haveCtrl = false;
+    for (int k = 1; k <= rest; ++k) {
+        int i = (first + k) % n;
+        if (on[i]) {
+            o.pts.push_back(haveCtrl ? ctrl : mid(last, p[i]));
+            o.pts.push_back(p[i]);
+            last = p[i];
+            haveCtrl = false;
+        }
+        else {
+            if (haveCtrl) {
+                last = mid(ctrl, p[i]);
+                o.pts.push_back(ctrl);
+                o.pts.push_back(last);
+            }
+            ctrl = p[i];
+            haveCtrl = true;
+        }
+    }
+    if (haveCtrl || last.x != start.x || last.y != start.y) {
+        o.pts.push_back(haveCtrl ? ctrl : mid(last, start));
+        o.pts.push_back(start);
+    }
+    o.ends.push_back(int(o.pts.size()));
+}
+
+// Appends the glyph's contours, transformed by [a c e; b d f]. Returns
+// false if the glyph's data runs past its end.
+inline bool fontOutlineAt(const BZfont& f, int glyph, const float* m, uint32_t depth, BZglyphOutline& o) {
+    uint32_t at, end;
+    fontGlyphRange(f, glyph, at, end);
+    if (at == end || depth > FONT_MAX_COMPOSITE_DEPTH) return true;
+    if (at + 10 > end) return false;
+    int contours = fontI16(f, at);
+    if (contours >= 0) {
+        size_t endPts = at + 10, instructions = endPts + size_t(contours) * 2;
+        if (instructions + 2 > end) return false;
+        int n = contours ? int(fontU16(f, instructions - 2)) + 1 : 0;
+        size_t flagsAt = instructions + 2 + fontU16(f, instructions);
+        std::vector<uint8_t> flags(n);
+        for (int i = 0; i < n;) {
+            if (flagsAt >= end) return false;
+            uint8_t fl = uint8_t(fontU8(f, flagsAt++));
+            int repeat = 0;
+            if (fl & 8) {
+                if (flagsAt >= end) return false;
+                repeat = int(fontU8(f, flagsAt++));
+            }
+            for (int r = 0; r <= repeat && i < n; ++r)
+                flags[i++] = fl;
+        }
+        std::vector<BZpoint> p(n);
+        std::vector<uint8_t> on(n);
+        int x = 0, y = 0;
+        size_t xy = flagsAt;
+        // A coordinate is a one-byte delta with the sign in the flags, a
+        // two-byte delta, or the same as the last one.
+        auto delta = [&](uint8_t fl, uint8_t isByte, uint8_t same, int& v) {
+            size_t size = fl & isByte ? 1 : fl & same ? 0 : 2;
+            if (xy + size > end) return false;
+            if (size == 1) v += fl & same ? int(fontU8(f, xy)) : -int(fontU8(f, xy));
+            else if (size == 2) v += fontI16(f, xy);
+            xy += size;
+            return true;
+        };
+        for (int i = 0; i < n; ++i) {
+            if (!delta(flags[i], 2, 16, x)) return false;
+            p[i].x = float(x);
+        }
+        for (int i = 0; i < n; ++i) {
+            if (!delta(flags[i], 4, 32, y)) return false;
+            p[i] = { m[0] * p[i].x + m[2] * y + m[4], m[1] * p[i].x + m[3] * y + m[5] };
+            on[i] = flags[i] & 1;
+        }
+        int begin = 0;
+        for (int k = 0; k < contours; ++k) {
+            int stop = std::min(int(fontU16(f, endPts + size_t(k) * 2)) + 1, n);
+            if (stop > begin)
+                fontAddContour(o, p.data() + begin, on.data() + begin, stop - begin);
+            begin = std::max(begin, stop);
+        }
+        return true;
+    }
+    // Composite: components with offsets and an optional scale or 2x2.
+    size_t c = at + 10;
+    for (;;) {
+        if (c + 4 > end) return false;
+        uint32_t flags = fontU16(f, c), component = fontU16(f, c + 2);
+        c += 4;
+        size_t args = (flags & 1 ? 4 : 2) + (flags & 8 ? 2 : flags & 0x40 ? 4 : flags & 0x80 ? 8 : 0);
+        if (c + args > end) return false;
+        float dx, dy;
+        if (flags & 1) {
+            dx = float(fontI16(f, c));
+            dy = float(fontI16(f, c + 2));
+            c += 4;
+        }
+        else {
+            dx = float(int8_t(fontU8(f, c)));
+            dy = float(int8_t(fontU8(f, c + 1)));
+            c += 2;
+        }
+        if (!(flags & 2)) dx = dy = 0;   // point matching is not supported
+        float t[4] = { 1, 0, 0, 1 };
+        const float F2DOT14 = 1.0f / 16384;
+        if (flags & 8) {
+            t[0] = t[3] = fontI16(f, c) * F2DOT14;
+            c += 2;
+        }
+        else if (flags & 0x40) {
+            t[0] = fontI16(f, c) * F2DOT14;
+            t[3] = fontI16(f, c + 2) * F2DOT14;
+            c += 4;
+        }
+        else if (flags & 0x80) {
+            for (int k = 0; k < 4; ++k)
+                t[k] = fontI16(f, c + k * 2) * F2DOT14;
+            c += 8;
+        }
+        float cm[6] = {
+            m[0] * t[0] + m[2] * t[1], m[1] * t[0] + m[3] * t[1],
+            m[0] * t[2] + m[2] * t[3], m[1] * t[2] + m[3] * t[3],
+            m[0] * dx + m[2] * dy + m[4], m[1] * dx + m[3] * dy + m[5] };
+        if (!fontOutlineAt(f, int(component), cm, depth + 1, o)) return false;
+        if (!(flags & 0x20) || c >= end) return true;
+    }
+}
+
+// The glyph's outline; empty if its data is corrupt.
+inline void fontOutline(const BZfont& f, int glyph, BZglyphOutline& o) {
+    o.pts.clear();
+    o.ends.clear();
+    const float identity[6] = { 1, 0, 0, 1, 0, 0 };
+    if (!fontOutlineAt(f, glyph, identity, 0, o)) {
+        o.pts.clear();
+        o.ends.clear();
+    }
+}
+
+// Tessellates contour k of o, in pixels (scale px per font unit, y down),
+// into poly; returns the vertex count. The closing point is dropped.
+inline int glyphFlatten(const BZglyphOutline& o, int k, float scale, float tolPx,
+                        std::vector<BZpoint>& poly, BZscratch& s) {
+    int begin = k ? o.ends[k - 1] : 0, end = o.ends[k];
+    poly.clear();
+    BZpoint q[3];
+    BZpoint seg[GLYPH_SEG_MAX];
+    for (int i = begin; i + 2 < end; i += 2) {
+        for (int j = 0; j < 3; ++j)
+            q[j] = { o.pts[i + j].x * scale, -o.pts[i + j].y * scale };
+        int n = bezierAdaptive(q, 3, tolPx, seg, GLYPH_SEG_MAX, s);
+        poly.insert(poly.end(), seg + (poly.empty() ? 0 : 1), seg + n);
+    }
+    if (poly.size() > 1) poly.pop_back();
+    return int(poly.size());
+}
+
+// Rasterizes a glyph at px pixels per em.
+inline void glyphRasterize(const BZfont& f, int glyph, float px, BZglyphBitmap& b, BZglyphScratch& gs) {
+    fontOutline(f, glyph, gs.outline);
+    b.w = b.h = 0;
+    if (gs.outline.pts.empty()) return;
+    float scale = px / f.unitsPerEm;
+    BZbox box = hullBox(gs.outline.pts.data(), int(gs.outline.pts.size()));
+    // One pixel of margin so edge pixels keep their partial coverage.
+    b.bearingX = int(std::floor(box.x0 * scale)) - 1;
+    b.bearingY = int(std::floor(-box.y1 * scale)) - 1;
+    b.w = int(std::ceil(box.x1 * scale)) + 1 - b.bearingX;
+    b.h = int(std::ceil(-box.y0 * scale)) + 1 - b.bearingY;
+    // No glyph of the font is bigger than the head table's bounds (nor its
+    // atlas cell); one that is comes from a corrupt font.
+    if (b.w > int(std::ceil((f.xMax - f.xMin) * scale)) + 3 || b.h > int(std::ceil((f.yMax - f.yMin) * scale)) + 3) {
+        b.w = b.h = 0;
+        return;
+    }
+    BZrasterLayer& layer = gs.layers[0];
+    layer.segs.clear();
+    BZpoint origin = { float(-b.bearingX), float(-b.bearingY) };
+    for (int k = 0; k < int(gs.outline.ends.size()); ++k) {
+        int n = glyphFlatten(gs.outline, k, scale, 0.2f, gs.poly, gs.s);
+        for (BZpoint& q : gs.poly)
+            q = q.add(origin);
+        rasterAddContour(layer, gs.poly.data(), n);
+    }
+    rasterRender(gs.pool, gs.r, gs.layers, b.w, b.h, gs.img);
+    b.cov.resize(gs.img.gray.size());
+    for (size_t i = 0; i < b.cov.size(); ++i)
+        b.cov[i] = uint8_t(255 - gs.img.gray[i]);
+}
+
+// Decodes one UTF-8 sequence at s, advancing it; malformed bytes decode as
+// U+FFFD.
+inline uint32_t utf8Next(const char*& s) {
+    uint8_t c = uint8_t(*s++);
+    if (c < 0x80) return c;
+    int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : -1;
+    if (extra < 0) return 0xFFFD;
+    uint32_t cp = c & (0x3F >> extra);
+    for (int k = 0; k < extra; ++k) {
+        if ((uint8_t(*s) & 0xC0) != 0x80) return 0xFFFD;
+        cp = cp << 6 | (uint8_t(*s++) & 0x3F);
+    }
+    return cp;
+}
@@ -0,0 +1,261 @@
+#pragma once
+#include <GL/glew.h>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "font.h"
+
+// Text drawing through a glyph atlas: one GL_R8 texture split into equal
+// cells, each big enough for any glyph of the font at the atlas's largest
+// size. Glyphs are rasterized on first use (font.h) and uploaded into a
+// cell with one glTexSubImage2D; the cells form an LRU list, so when the
+// atlas is full the least recently drawn glyph is replaced. Text between
+// textBegin() and textEnd() is batched into one vertex buffer of quads and
+// drawn with one glDrawArrays. Only if a frame needs more distinct glyphs
+// than there are cells is the batch flushed early to free cells.
+//
+// Positions are window pixels, y down; glyphs snap to whole pixels so the
+// atlas is sampled texel for texel.
+
+const int ATLAS_SIZE = 1024;
+
+const char* const ATLAS_VS = R"(
+#version 330
+layout(location=0) in vec4 quad;   // pixel position, atlas texel
+uniform vec2 screen;
+uniform float atlasSize;
+out vec2 uv;
+void main() {
+    uv = quad.zw / atlasSize;
+    gl_Position = vec4(quad.x * 2.0 / screen.x - 1.0, 1.0 - quad.y * 2.0 / screen.y, 0.0, 1.0);
+}
+)";
+
+const char* const ATLAS_FS = R"(
+#version 330
+in vec2 uv;
+out vec4 color;
+uniform sampler2D atlas;
+uniform vec3 col;
+void main() {
+    color = vec4(col, texture(atlas, uv).r);
+}
+)";
+
+struct BZatlasCell {
+    uint32_t key = 0;             // glyph << 8 | pixel size
+    int w = 0, h = 0, bearingX = 0, bearingY = 0;
+    int prev = -1, next = -1;     // LRU list, most recent first
+    uint32_t frame = 0;           // last frame the cell was drawn in
+};
+
+struct BZglyphAtlas {
+    const BZfont* font = nullptr;
+    GLuint prog = 0, vao = 0, vbo = 0, tex = 0;
+    GLint locScreen = -1, locAtlasSize = -1, locCol = -1;
+    int maxPx = 0;
+    int cellW = 0, cellH = 0, cols = 0;
+    std::vector<BZatlasCell> cells;
+    int head = -1, tail = -1;
+    // Glyph key -> cell, or -1 for glyphs with nothing to draw.
+    std::unordered_map<uint32_t, int> lookup;
+    uint32_t frame = 1;           // counts batches
+    std::vector<float> quads;     // 6 vertices of x, y, u, v per glyph
+    int screenW = 0, screenH = 0;
+    float col[3] = { 1, 1, 1 };
+    BZglyphScratch scratch;
+    BZglyphBitmap bitmap;
+    // Per frame, for the window title.
+    int uploads = 0, draws = 0, glyphs = 0;
+};
+
+inline void atlasUnlink(BZglyphAtlas& a, int c) {
+    BZatlasCell& cell = a.cells[c];
+    if (cell.prev >= 0) a.cells[cell.prev].next = cell.next;
+    else a.head = cell.next;
+    if (cell.next >= 0) a.cells[cell.next].prev = cell.prev;
+    else a.tail = cell.prev;
+    cell.prev = cell.next = -1;
+}
+
+inline void atlasPushFront(BZglyphAtlas& a, int c) {
+    a.cells[c].next = a.head;
+    a.cells[c].prev = -1;
+    if (a.head >= 0) a.cells[a.head].prev = c;
+    a.head = c;
+    if (a.tail < 0) a.tail = c;
+}
+
+// Sizes the cells for glyphs up to maxPx (at most 255) pixels per em and
+// builds the texture and shader, replacing those of an earlier call.
+// Returns false if the shader does not link.
+inline bool atlasInit(BZglyphAtlas& a, const BZfont& font, int maxPx) {
+    a.font = &font;
+    a.maxPx = std::min(std::max(maxPx, 1), 255);
+    float scale = float(a.maxPx) / font.unitsPerEm;
+    // The glyph bitmaps add a pixel of margin on each side and round out.
+    a.cellW = std::min(int(std::ceil((font.xMax - font.xMin) * scale)) + 4, ATLAS_SIZE);
+    a.cellH = std::min(int(std::ceil((font.yMax - font.yMin) * scale)) + 4, ATLAS_SIZE);
+    a.cols = ATLAS_SIZE / a.cellW;
+    int count = a.cols * (ATLAS_SIZE / a.cellH);
+    a.cells.assign(count, BZatlasCell());
+    a.lookup.clear();
+    a.head = a.tail = -1;
+    for (int c = 0; c < count; ++c)
+        atlasPushFront(a, c);
+
+    if (a.prog) glDeleteProgram(a.prog);
+    if (a.tex) glDeleteTextures(1, &a.tex);
+    if (a.vao) glDeleteVertexArrays(1, &a.vao);
+    if (a.vbo) glDeleteBuffers(1, &a.vbo);
+
+    GLuint vert = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vert, 1, &ATLAS_VS, NULL);
+    glCompileShader(vert);
+    GLuint frag = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(frag, 1, &ATLAS_FS, NULL);
+    glCompileShader(frag);
+    a.prog = glCreateProgram();
+    glAttachShader(a.prog, vert);
+    glAttachShader(a.prog, frag);
+    glLinkProgram(a.prog);
+    glDeleteShader(vert);
+    glDeleteShader(frag);
+    GLint linked = 0;
+    glGetProgramiv(a.prog, GL_LINK_STATUS, &linked);
+    a.locScreen = glGetUniformLocation(a.prog, "screen");
+    a.locAtlasSize = glGetUniformLocation(a.prog, "atlasSize");
+    a.locCol = glGetUniformLocation(a.prog, "col");
+
+    glGenTextures(1, &a.tex);
+    glBindTexture(GL_TEXTURE_2D, a.tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_SIZE, ATLAS_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenVertexArrays(1, &a.vao);
+    glGenBuffers(1, &a.vbo);
+    glBindVertexArray(a.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, a.vbo);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(0);
+    return linked != 0;
+}
+
+// Draws and clears the batched quads.
+inline void atlasFlush(BZglyphAtlas& a) {
+    if (a.quads.empty()) return;
+    glUseProgram(a.prog);
+    glUniform2f(a.locScreen, float(a.screenW), float(a.screenH));
+    glUniform1f(a.locAtlasSize, float(ATLAS_SIZE));
+    glUniform3f(a.locCol, a.col[0], a.col[1], a.col[2]);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, a.tex);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindVertexArray(a.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, a.vbo);
+    // Orphaned each time so the driver never waits on the previous batch.
+    glBufferData(GL_ARRAY_BUFFER, a.quads.size() * sizeof(float), a.quads.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, GLsizei(a.quads.size() / 4));
+    glDisable(GL_BLEND);
+    a.glyphs += int(a.quads.size() / 24);
+    ++a.draws;
+    a.quads.clear();
+}
+
+// The cell holding glyph at px pixels per em, rasterizing and uploading it
+// on a miss; -1 if the glyph is blank.
+inline int atlasCell(BZglyphAtlas& a, int glyph, int px) {
+    uint32_t key = uint32_t(glyph) << 8 | uint32_t(px);
+    auto it = a.lookup.find(key);
+    if (it != a.lookup.end()) {
+        int c = it->second;
+        if (c >= 0) {
+            atlasUnlink(a, c);
+            atlasPushFront(a, c);
+            a.cells[c].frame = a.frame;
+        }
+        return c;
+    }
+    glyphRasterize(*a.font, glyph, float(px), a.bitmap, a.scratch);
+    if (a.bitmap.w <= 0 || a.bitmap.h <= 0) {
+        a.lookup[key] = -1;
+        return -1;
+    }
+    int c = a.tail;
+    if (c < 0) return -1;
+    if (a.cells[c].frame == a.frame) {
+        // Every cell is in the batch: draw it, then they are all free.
+        atlasFlush(a);
+        ++a.frame;
+    }
+    BZatlasCell& cell = a.cells[c];
+    if (cell.w > 0)
+        a.lookup.erase(cell.key);
+    cell.key = key;
+    cell.w = std::min(a.bitmap.w, a.cellW);
+    cell.h = std::min(a.bitmap.h, a.cellH);
+    cell.bearingX = a.bitmap.bearingX;
+    cell.bearingY = a.bitmap.bearingY;
+    cell.frame = a.frame;
+    atlasUnlink(a, c);
+    atlasPushFront(a, c);
+    a.lookup[key] = c;
+
+    glBindTexture(GL_TEXTURE_2D, a.tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, a.bitmap.w);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (c % a.cols) * a.cellW, (c / a.cols) * a.cellH, cell.w, cell.h,
+        GL_RED, GL_UNSIGNED_BYTE, a.bitmap.cov.data());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    ++a.uploads;
+    return c;
+}
+
+inline void textBegin(BZglyphAtlas& a, int screenW, int screenH, float r, float g, float b) {
+    a.screenW = screenW;
+    a.screenH = screenH;
+    a.col[0] = r;
+    a.col[1] = g;
+    a.col[2] = b;
+    a.uploads = a.draws = a.glyphs = 0;
+}
+
+// Queues UTF-8 text with its baseline starting at (x, y); returns the
+// advance in pixels. Sizes above the atlas's maxPx are clamped.
+inline float textAdd(BZglyphAtlas& a, const char* s, float x, float y, int px) {
+    px = std::min(std::max(px, 1), a.maxPx);
+    const BZfont& f = *a.font;
+    float scale = float(px) / f.unitsPerEm;
+    float pen = x;
+    int baseline = int(std::lround(y));
+    while (*s) {
+        int glyph = fontGlyph(f, utf8Next(s));
+        int c = atlasCell(a, glyph, px);
+        if (c >= 0) {
+            const BZatlasCell& cell = a.cells[c];
+            float x0 = float(std::lround(pen) + cell.bearingX), y0 = float(baseline + cell.bearingY);
+            float x1 = x0 + cell.w, y1 = y0 + cell.h;
+            float u0 = float((c % a.cols) * a.cellW), v0 = float((c / a.cols) * a.cellH);
+            float u1 = u0 + cell.w, v1 = v0 + cell.h;
+            const float v[24] = {
+                x0, y0, u0, v0,  x1, y0, u1, v0,  x1, y1, u1, v1,
+                x0, y0, u0, v0,  x1, y1, u1, v1,  x0, y1, u0, v1 };
+            a.quads.insert(a.quads.end(), v, v + 24);
+        }
+        pen += fontAdvance(f, glyph) * scale;
+    }
+    return pen - x;
+}
+
+// Draws everything queued since textBegin().
+inline void textEnd(BZglyphAtlas& a) {
+    atlasFlush(a);
+    ++a.frame;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <GL/glew.h>
+#include <algorithm>
+#include "bezier.h"
+
+// Bezier evaluation in the vertex shader. Only the control points are
+// uploaded, into a texture buffer (core in GL 3.1, so it works with the
+// #version 330 pipeline and Mesa's software rasterizer); the curve is drawn
+// as a GL_LINE_STRIP of samples vertices with no attributes, and each
+// vertex evaluates the curve at t = gl_VertexID / (samples - 1). An edit
+// then uploads 8 bytes per control point instead of the whole polyline.
+//
+// The shader uses the scaled Bernstein walk of bezierEvalHigh() (see
+// bernstein.h) in float: O(sqrt(n)) texel fetches per vertex, no local
+// arrays, and no limit on the degree.
+
+const char* const GPU_CURVE_VS = R"(
+#version 330
+uniform samplerBuffer ctrl;
+uniform int count;
+uniform int samples;
+uniform vec3 view;
+
+vec2 ctrlAt(int i) {
+    return texelFetch(ctrl, i).xy;
+}
+
+vec2 bezierAt(float t) {
+    int d = count - 1;
+    if (d <= 0 || t <= 0.0) return ctrlAt(0);
+    if (t >= 1.0) return ctrlAt(d);
+    float u = 1.0 - t;
+    int k = int(floor(float(d) * t + 0.5));
+    vec2 s = ctrlAt(k);
+    float sw = 1.0;
+    float r = t / u, w = 1.0;
+    for (int i = k + 1; i <= d && w > 1e-9; ++i) {
+        w *= float(d - i + 1) / float(i) * r;
+        s += w * ctrlAt(i);
+        sw += w;
+    }
+    r = u / t;
+    w = 1.0;
+    for (int i = k - 1; i >= 0 && w > 1e-9; --i) {
+        w *= float(i + 1) / float(d - i) * r;
+        s += w * ctrlAt(i);
+        sw += w;
+    }
+    return s / sw;
+}
+
+void main() {
+    float t = float(gl_VertexID) / float(max(samples - 1, 1));
+    gl_Position = vec4(bezierAt(t) * view.x + view.yz, 0.0, 1.0);
+}
+)";
+
+struct BZgpuCurve {
+    GLuint prog = 0;
+    GLuint vao = 0;     // empty; core profiles need one bound to draw
+    GLuint buf = 0, tex = 0;
+    int capacity = 0;   // control points the buffer holds
+    int count = 0;
+    GLint locCount = -1, locSamples = -1, locView = -1, locCol = -1;
+    bool ok = false;
+};
+
+// Links the evaluation shader with fragSrc, which must take a vec3 col
+// uniform. g.ok is false if the driver rejects it.
+inline void gpuCurveInit(BZgpuCurve& g, const char* fragSrc) {
+    GLuint vert = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vert, 1, &GPU_CURVE_VS, NULL);
+    glCompileShader(vert);
+
+    GLuint frag = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(frag, 1, &fragSrc, NULL);
+    glCompileShader(frag);
+
+    g.prog = glCreateProgram();
+    glAttachShader(g.prog, vert);
+    glAttachShader(g.prog, frag);
+    glLinkProgram(g.prog);
+    glDeleteShader(vert);
+    glDeleteShader(frag);
+
+    GLint linked = 0;
+    glGetProgramiv(g.prog, GL_LINK_STATUS, &linked);
+    g.ok = linked != 0;
+    g.locCount = glGetUniformLocation(g.prog, "count");
+    g.locSamples = glGetUniformLocation(g.prog, "samples");
+    g.locView = glGetUniformLocation(g.prog, "view");
+    g.locCol = glGetUniformLocation(g.prog, "col");
+
+    glGenVertexArrays(1, &g.vao);
+    glGenBuffers(1, &g.buf);
+    glGenTextures(1, &g.tex);
+}
+
+// Uploads the control points; the buffer only reallocates when outgrown.
+inline void gpuCurveUpload(BZgpuCurve& g, const BZpoint* p, int n) {
+    glBindBuffer(GL_TEXTURE_BUFFER, g.buf);
+    if (n > g.capacity) {
+        g.capacity = std::max(n, g.capacity * 2);
+        glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(g.capacity) * sizeof(BZpoint), nullptr, GL_DYNAMIC_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, g.tex);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, g.buf);
+    }
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, GLsizeiptr(n) * sizeof(BZpoint), p);
+    g.count = n;
+}
+
+// Draws the curve as samples vertices. Leaves g.prog in use.
+inline void gpuCurveDraw(const BZgpuCurve& g, int samples, float scale, BZpoint offset, float r, float gr, float b) {
+    if (g.count < 1 || samples < 2) return;
+    glUseProgram(g.prog);
+    glUniform1i(g.locCount, g.count);
+    glUniform1i(g.locSamples, samples);
+    glUniform3f(g.locView, scale, offset.x, offset.y);
+    glUniform3f(g.locCol, r, gr, b);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, g.tex);
+    glBindVertexArray(g.vao);
+    glDrawArrays(GL_LINE_STRIP, 0, samples);
+}
@@ -0,0 +1,228 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cmath>
+#include "bezier.h"
+#include "tessellate.h"
+#include "bounds.h"
+#include "bzfile.h"
+
+// Curve-curve intersections.
+//
+// Broadphase: exact boxes of all curves, sorted by x0 and swept, give the
+// candidate pairs. Narrowphase per pair: recursive subdivision, dropping
+// piece pairs whose control-point boxes are disjoint, until both pieces are
+// flat to within tol; their chords are intersected and the result polished
+// with Newton's method on A(s) - B(t) = 0. Overlapping (collinear) pieces
+// report no hits. Hits closer than tol on both curves are merged.
+
+const int X_MAX_DEPTH = 24;
+const int X_NEWTON = 3;
+
+struct BZxhit {
+    int a, b;        // curve indices, a < b for batch results
+    float ta, tb;
+    BZpoint pos;
+};
+
+struct BZxscratch {
+    std::vector<BZpoint> pieces;   // stack of piece pairs, n + m points each
+    std::vector<float> range;      // a0, a1, b0, b1 per stack entry
+    std::vector<int> depth;
+    std::vector<BZpoint> da, db;   // hodographs for Newton
+    BZscratch s;
+};
+
+// Intersection of segments p0p1 and q0q1; u, v are the segment parameters.
+inline bool chordIntersect(BZpoint p0, BZpoint p1, BZpoint q0, BZpoint q1, float& u, float& v) {
+    float rx = p1.x - p0.x, ry = p1.y - p0.y;
+    float sx = q1.x - q0.x, sy = q1.y - q0.y;
+    float den = rx * sy - ry * sx;
+    float scale = std::fabs(rx * sx + ry * sy) + std::fabs(den);
+    if (std::fabs(den) <= 1e-7f * scale || scale == 0) return false;
+    float wx = q0.x - p0.x, wy = q0.y - p0.y;
+    u = (wx * sy - wy * sx) / den;
+    v = (wx * ry - wy * rx) / den;
+    // A hair of slack so a crossing exactly at a split point is not lost.
+    const float e = 1e-5f;
+    return u >= -e && u <= 1 + e && v >= -e && v <= 1 + e;
+}
+
+// Newton on A(s) - B(t) = 0 from (s, t); keeps the start if it diverges.
+inline void polishHit(const BZpoint* p, int n, const BZpoint* q, int m, BZxscratch& x, float& s, float& t) {
+    if (n < 2 || m < 2) return;
+    BZpoint* tmp = x.s.get(std::max(n, m));
+    BZpoint a = bezierEvalFast(s, p, n, tmp), b = bezierEvalFast(t, q, m, tmp);
+    float err = a.dist(b);
+    for (int it = 0; it < X_NEWTON && err > 0; ++it) {
+        BZpoint da = bezierEvalFast(s, x.da.data(), n - 1, tmp);
+        BZpoint db = bezierEvalFast(t, x.db.data(), m - 1, tmp);
+        // [da -db] [ds dt]^T = b - a
+        float det = -da.x * db.y + da.y * db.x;
+        if (std::fabs(det) < 1e-12f) break;
+        float fx = b.x - a.x, fy = b.y - a.y;
+        float ds = (-fx * db.y + fy * db.x) / det;
+        float dt = (da.x * fy - da.y * fx) / det;
+        float ns = s + ds, nt = t + dt;
+        if (ns < 0 || ns > 1 || nt < 0 || nt > 1) break;
+        BZpoint na = bezierEvalFast(ns, p, n, tmp), nb = bezierEvalFast(nt, q, m, tmp);
+        float nerr = na.dist(nb);
+        if (nerr >= err) break;
+        s = ns;
+        t = nt;
+        a = na;
+        err = nerr;
+    }
+}
+
+// Intersections of curves p (n points) and q (m points), appended to out
+// with a = ia and b = ib. Returns the number found.
+inline int intersectPair(const BZpoint* p, int n, const BZpoint* q, int m, float tol,
+                         int ia, int ib, std::vector<BZxhit>& out, BZxscratch& x) {
+    if (n < 2 || m < 2) return 0;
+    size_t first = out.size();
+    int w = n + m;
+    size_t cap = 2 * X_MAX_DEPTH + 2;
+    if (x.pieces.size() < cap * w + 2 * size_t(std::max(n, m))) x.pieces.resize(cap * w + 2 * size_t(std::max(n, m)));
+    if (x.range.size() < cap * 4) x.range.resize(cap * 4);
+    if (x.depth.size() < cap) x.depth.resize(cap);
+    x.da.resize(n - 1);
+    x.db.resize(m - 1);
+    hodograph(p, n, x.da.data());
+    hodograph(q, m, x.db.data());
+    BZpoint* right = x.pieces.data() + cap * w;
+    BZpoint* tmp = right + std::max(n, m);
+
+    std::copy(p, p + n, x.pieces.begin());
+    std::copy(q, q + m, x.pieces.begin() + n);
+    float* r = x.range.data();
+    r[0] = 0; r[1] = 1; r[2] = 0; r[3] = 1;
+    x.depth[0] = 0;
+    int top = 0;
+    while (top >= 0) {
+        BZpoint* A = x.pieces.data() + size_t(top) * w;
+        BZpoint* B = A + n;
+        float* rg = r + top * 4;
+        int d = x.depth[top];
+        if (!hullBox(A, n).overlaps(hullBox(B, m))) {
+            --top;
+            continue;
+        }
+        bool flatA = isFlat(A, n, tol), flatB = isFlat(B, m, tol);
+        if ((flatA && flatB) || d >= X_MAX_DEPTH) {
+            float u, v;
+            if (chordIntersect(A[0], A[n - 1], B[0], B[m - 1], u, v)) {
+                u = std::min(std::max(u, 0.0f), 1.0f);
+                v = std::min(std::max(v, 0.0f), 1.0f);
+                float s = rg[0] + u * (rg[1] - rg[0]);
+                float t = rg[2] + v * (rg[3] - rg[2]);
+                polishHit(p, n, q, m, x, s, t);
+                out.push_back({ ia, ib, s, t, bezierEvalFast(s, p, n, x.s.get(n)) });
+            }
+            --top;
+            continue;
+        }
+        // Split the piece that is not flat, or the larger one.
+        BZbox ba = hullBox(A, n), bb = hullBox(B, m);
+        float sa = std::max(ba.x1 - ba.x0, ba.y1 - ba.y0), sb = std::max(bb.x1 - bb.x0, bb.y1 - bb.y0);
+        bool splitA = !flatA && (flatB || sa >= sb);
+        // The entry above gets the second half, this one keeps the first.
+        BZpoint* next = A + w;
+        float* nr = rg + 4;
+        std::copy(A, A + w, next);
+        nr[0] = rg[0]; nr[1] = rg[1]; nr[2] = rg[2]; nr[3] = rg[3];
+        if (splitA) {
+            float mid = (rg[0] + rg[1]) * 0.5f;
+            splitHalf(A, n, A, right, tmp);
+            std::copy(right, right + n, next);
+            rg[1] = mid;
+            nr[0] = mid;
+        }
+        else {
+            float mid = (rg[2] + rg[3]) * 0.5f;
+            splitHalf(B, m, B, right, tmp);
+            std::copy(right, right + m, next + n);
+            rg[3] = mid;
+            nr[2] = mid;
+        }
+        x.depth[top] = x.depth[top + 1] = d + 1;
+        ++top;
+    }
+
+    // Neighbouring pieces can both report a crossing at their shared end.
+    std::sort(out.begin() + first, out.end(), [](const BZxhit& h, const BZxhit& k) { return h.ta < k.ta; });
+    size_t keep = first;
+    for (size_t i = first; i < out.size(); ++i) {
+        bool dup = false;
+        for (size_t j = first; j < keep && !dup; ++j)
+            dup = out[j].pos.dist(out[i].pos) <= tol;
+        if (!dup) out[keep++] = out[i];
+    }
+    out.resize(keep);
+    return int(keep - first);
+}
+
+// Candidate pairs (i < j) whose exact boxes overlap, by sort and sweep on x.
+inline void broadphasePairs(const BZdocView& v, std::vector<std::pair<int, int>>& pairs) {
+    int count = int(v.curveCount);
+    std::vector<BZbox> boxes(count);
+    std::vector<int> order(count);
+    BZscratch s;
+    for (int c = 0; c < count; ++c) {
+        boxes[c] = exactBox(v.pts + v.curves[c].first, int(v.curves[c].count), s);
+        order[c] = c;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return boxes[a].x0 < boxes[b].x0; });
+    pairs.clear();
+    for (int i = 0; i < count; ++i) {
+        const BZbox& bi = boxes[order[i]];
+        for (int j = i + 1; j < count && boxes[order[j]].x0 <= bi.x1; ++j)
+            if (bi.overlaps(boxes[order[j]]))
+                pairs.push_back({ std::min(order[i], order[j]), std::max(order[i], order[j]) });
+    }
+}
+
+// All intersections between the curves of v, sorted by (a, b, ta). Pairs
+// are handed out to threads in chunks; threads = 0 uses every core.
+inline void intersectAll(const BZdocView& v, float tol, int threads, std::vector<BZxhit>& out,
+                         size_t* candidates = nullptr) {
+    std::vector<std::pair<int, int>> pairs;
+    broadphasePairs(v, pairs);
+    if (candidates) *candidates = pairs.size();
+    if (threads <= 0)
+        threads = std::max(1, int(std::thread::hardware_concurrency()));
+    threads = int(std::min<size_t>(threads, pairs.size() / 64 + 1));
+
+    const size_t CHUNK = 64;
+    std::atomic<size_t> next(0);
+    std::vector<std::vector<BZxhit>> found(threads);
+    auto work = [&](int id) {
+        BZxscratch x;
+        for (;;) {
+            size_t lo = next.fetch_add(CHUNK);
+            if (lo >= pairs.size()) break;
+            size_t hi = std::min(lo + CHUNK, pairs.size());
+            for (size_t k = lo; k < hi; ++k) {
+                const BZcurveRec& a = v.curves[pairs[k].first];
+                const BZcurveRec& b = v.curves[pairs[k].second];
+                intersectPair(v.pts + a.first, int(a.count), v.pts + b.first, int(b.count), tol,
+                    pairs[k].first, pairs[k].second, found[id], x);
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t)
+        pool.emplace_back(work, t);
+    work(0);
+    for (std::thread& t : pool)
+        t.join();
+
+    out.clear();
+    for (const std::vector<BZxhit>& f : found)
+        out.insert(out.end(), f.begin(), f.end());
+    std::sort(out.begin(), out.end(), [](const BZxhit& h, const BZxhit& k) {
+        return h.a != k.a ? h.a < k.a : (h.b != k.b ? h.b < k.b : h.ta < k.ta);
+    });
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "bezier.h"
+
+// Hashed uniform grid over the control points for hit testing. Cells are
+// unbounded (coordinates are hashed into a power-of-two bucket table), so
+// points far outside the window cost nothing extra. Kept in sync with the
+// point array by gridInsert / gridErase / gridMove.
+struct BZgrid {
+    float cell = 0.05f;
+    std::vector<std::vector<int>> buckets;
+    std::vector<uint32_t> slot;   // bucket holding each point
+};
+
+inline int gridCoord(const BZgrid& g, float v) {
+    return int(std::floor(v / g.cell));
+}
+
+inline uint32_t gridBucket(const BZgrid& g, int cx, int cy) {
+    uint32_t h = uint32_t(cx) * 73856093u ^ uint32_t(cy) * 19349663u;
+    return h & uint32_t(g.buckets.size() - 1);
+}
+
+inline uint32_t gridBucketOf(const BZgrid& g, BZpoint p) {
+    return gridBucket(g, gridCoord(g, p.x), gridCoord(g, p.y));
+}
+
+// Rebuilds the grid for p[0..n) with the given cell size (normally the pick radius).
+inline void gridBuild(BZgrid& g, const BZpoint* p, int n, float cell) {
+    g.cell = cell;
+    size_t nb = 64;
+    while (nb < size_t(n)) nb *= 2;
+    g.buckets.assign(nb, std::vector<int>());
+    g.slot.resize(n);
+    for (int i = 0; i < n; ++i) {
+        g.slot[i] = gridBucketOf(g, p[i]);
+        g.buckets[g.slot[i]].push_back(i);
+    }
+}
+
+inline void gridRemoveFromBucket(BZgrid& g, int i) {
+    std::vector<int>& b = g.buckets[g.slot[i]];
+    b.erase(std::find(b.begin(), b.end(), i));
+}
+
+// p[i] has just been inserted (n is the new point count).
+inline void gridInsert(BZgrid& g, const BZpoint* p, int n, int i) {
+    if (size_t(n) > 2 * g.buckets.size()) {
+        gridBuild(g, p, n, g.cell);
+        return;
+    }
+    if (i < n - 1)
+        for (std::vector<int>& b : g.buckets)
+            for (int& j : b)
+                if (j >= i) ++j;
+    g.slot.insert(g.slot.begin() + i, gridBucketOf(g, p[i]));
+    g.buckets[g.slot[i]].push_back(i);
+}
+
+// Point i has just been erased from the array.
+inline void gridErase(BZgrid& g, int i) {
+    gridRemoveFromBucket(g, i);
+    g.slot.erase(g.slot.begin() + i);
+    if (i < int(g.slot.size()))
+        for (std::vector<int>& b : g.buckets)
+            for (int& j : b)
+                if (j > i) --j;
+}
+
+// Point i moved to q.
+inline void gridMove(BZgrid& g, int i, BZpoint q) {
+    uint32_t s = gridBucketOf(g, q);
+    if (s == g.slot[i]) return;
+    gridRemoveFromBucket(g, i);
+    g.slot[i] = s;
+    g.buckets[s].push_back(i);
+}
+
+// Lowest index with |p[i] - q| < r, or -1 (the same answer as a linear scan).
+inline int gridPick(const BZgrid& g, const BZpoint* p, BZpoint q, float r) {
+    float r2 = r * r;
+    int x0 = gridCoord(g, q.x - r), x1 = gridCoord(g, q.x + r);
+    int y0 = gridCoord(g, q.y - r), y1 = gridCoord(g, q.y + r);
+    int best = -1;
+    auto scan = [&](const std::vector<int>& b) {
+        for (int j : b) {
+            float dx = p[j].x - q.x, dy = p[j].y - q.y;
+            if (dx * dx + dy * dy < r2 && (best < 0 || j < best))
+                best = j;
+        }
+    };
+    // Hash collisions may map several cells to one bucket; scanning a bucket
+    // twice is harmless. A radius spanning more cells than buckets just scans
+    // every bucket once.
+    if (size_t(x1 - x0 + 1) * size_t(y1 - y0 + 1) >= g.buckets.size()) {
+        for (const std::vector<int>& b : g.buckets)
+            scan(b);
+        return best;
+    }
+    for (int cy = y0; cy <= y1; ++cy)
+        for (int cx = x0; cx <= x1; ++cx)
+            scan(g.buckets[gridBucket(g, cx, cy)]);
+    return best;
+}
@@ -0,0 +1,319 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "bezier.h"
+#include "bzsimd.h"
+#include "tessellate.h"
+#include "stroke.h"
+#include "fill.h"
+#include "bounds.h"
+#include "threadpool.h"
+#include "bzfile.h"
+
+// Anti-aliased software rasterizer, for rendering documents without a GPU.
+//
+// Coverage is exact area coverage by signed-area accumulation, as in font
+// rasterizers: every edge adds, to each cell it passes through, the signed
+// area it sweeps to the cell's right edge, plus the remainder to the next
+// cell. A running sum along the row then gives the winding-weighted
+// coverage of every pixel: clamped |sum| for nonzero, the distance to the
+// nearest even winding for even-odd. The sum is done four pixels per SSE2
+// step.
+//
+// The image is split into RASTER_TILE-row tiles, which are rendered on the
+// pool; each layer's edges are binned by tile first. Layers composite in
+// order, each darkening the white canvas by ink * coverage. Strokes are
+// the stroker's triangle strips with every triangle turned to the same
+// orientation, so overlapping triangles add up and clamp to full coverage.
+
+const int RASTER_TILE = 32;
+
+struct BZrasterLayer {
+    std::vector<BZpoint> segs;   // edges as a, b pairs, in pixels
+    FillRule rule = FILL_NONZERO;
+    float ink = 1;
+};
+
+struct BZrasterWorker {
+    std::vector<float> acc, shade;
+};
+
+struct BZrasterizer {
+    std::vector<std::vector<int>> binFirst, binSegs;   // per layer, CSR by tile
+    std::vector<BZrasterWorker> workers;
+};
+
+struct BZimage {
+    int w = 0, h = 0;
+    std::vector<uint8_t> gray;
+};
+
+inline void rasterAddContour(BZrasterLayer& l, const BZpoint* p, int n) {
+    for (int i = 0; i < n; ++i) {
+        l.segs.push_back(p[i]);
+        l.segs.push_back(p[i + 1 < n ? i + 1 : 0]);
+    }
+}
+
+// Adds the triangles of a strip, all counter-clockwise in pixel space.
+inline void rasterAddStrip(BZrasterLayer& l, const BZpoint* v, int n) {
+    for (int i = 0; i + 2 < n; ++i) {
+        BZpoint a = v[i], b = v[i + 1], c = v[i + 2];
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (area == 0) continue;
+        if (area < 0) std::swap(b, c);
+        BZpoint e[6] = { a, b, b, c, c, a };
+        l.segs.insert(l.segs.end(), e, e + 6);
+    }
+}
+
+// Accumulates a piece with a.y < b.y and x within the row into acc, whose
+// first row is image row y0.
+inline void rasterPiece(float* acc, int stride, int y0, BZpoint a, BZpoint b, float dir) {
+    float dxdy = (b.x - a.x) / (b.y - a.y);
+    float x = a.x;
+    int yEnd = int(std::ceil(b.y));
+    for (int y = int(a.y); y < yEnd; ++y) {
+        float* row = acc + size_t(y - y0) * stride;
+        float dy = std::min(float(y + 1), b.y) - std::max(float(y), a.y);
+        float xnext = x + dxdy * dy;
+        float d = dy * dir;
+        float x0 = std::min(x, xnext), x1 = std::max(x, xnext);
+        float x0floor = std::floor(x0), x1ceil = std::ceil(x1);
+        int x0i = int(x0floor), x1i = int(x1ceil);
+        if (x1i <= x0i + 1) {
+            // Within one cell: split by the mean x.
+            float xmf = 0.5f * (x + xnext) - x0floor;
+            row[x0i] += d - d * xmf;
+            row[x0i + 1] += d * xmf;
+        }
+        else {
+            float s = 1 / (x1 - x0);
+            float x0f = x0 - x0floor;
+            float a0 = 0.5f * s * (1 - x0f) * (1 - x0f);
+            float x1f = x1 - x1ceil + 1;
+            float am = 0.5f * s * x1f * x1f;
+            row[x0i] += d * a0;
+            if (x1i == x0i + 2)
+                row[x0i + 1] += d * (1 - a0 - am);
+            else {
+                float a1 = s * (1.5f - x0f);
+                row[x0i + 1] += d * (a1 - a0);
+                for (int xi = x0i + 2; xi < x1i - 1; ++xi)
+                    row[xi] += d * s;
+                float a2 = a1 + (x1i - x0i - 3) * s;
+                row[x1i - 1] += d * (1 - a2 - am);
+            }
+            row[x1i] += d * am;
+        }
+        x = xnext;
+    }
+}
+
+// Accumulates edge a-b into rows [y0, y0 + rows) of a w pixel wide image.
+// Parts left or right of the image are moved onto its border, where they
+// still carry their winding.
+inline void rasterEdge(float* acc, int stride, int w, int y0, int rows, BZpoint a, BZpoint b) {
+    if (a.y == b.y) return;
+    float dir = 1;
+    if (a.y > b.y) {
+        std::swap(a, b);
+        dir = -1;
+    }
+    float top = float(y0), bot = float(y0 + rows);
+    if (b.y <= top || a.y >= bot) return;
+    float dxdy = (b.x - a.x) / (b.y - a.y);
+    if (a.y < top) {
+        a.x += (top - a.y) * dxdy;
+        a.y = top;
+    }
+    if (b.y > bot) {
+        b.x -= (b.y - bot) * dxdy;
+        b.y = bot;
+    }
+    float right = float(w);
+    float ys[4] = { a.y, 0, 0, 0 };
+    int k = 1;
+    for (float xb : { 0.0f, right })
+        if ((a.x - xb) * (b.x - xb) < 0)
+            ys[k++] = a.y + (xb - a.x) / dxdy;
+    if (k == 3 && ys[2] < ys[1]) std::swap(ys[1], ys[2]);
+    ys[k++] = b.y;
+    for (int i = 0; i + 1 < k; ++i) {
+        if (!(ys[i + 1] > ys[i])) continue;
+        BZpoint p = { a.x + (ys[i] - a.y) * dxdy, ys[i] };
+        BZpoint q = { i + 2 == k ? b.x : a.x + (ys[i + 1] - a.y) * dxdy, ys[i + 1] };
+        p.x = std::min(std::max(p.x, 0.0f), right);
+        q.x = std::min(std::max(q.x, 0.0f), right);
+        rasterPiece(acc, stride, y0, p, q, dir);
+    }
+}
+
+// Running sum of one accumulation row into coverage, in place.
+inline void rasterCoverage(float* row, int w, FillRule rule) {
+    int x = 0;
+    float sum = 0;
+#if BZ_X86
+    const __m128 one = _mm_set1_ps(1), two = _mm_set1_ps(2), half = _mm_set1_ps(0.5f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 offset = _mm_setzero_ps();
+    for (; x + 4 <= w; x += 4) {
+        __m128 v = _mm_loadu_ps(row + x);
+        v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+        v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+        v = _mm_add_ps(v, offset);
+        offset = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+        __m128 c = _mm_and_ps(v, absMask);
+        if (rule == FILL_EVEN_ODD) {
+            // |sum| mod 2, folded about 1; truncation is floor for c >= 0.
+            __m128 q = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(c, half)));
+            c = _mm_sub_ps(c, _mm_mul_ps(q, two));
+            c = _mm_min_ps(c, _mm_sub_ps(two, c));
+        }
+        _mm_storeu_ps(row + x, _mm_min_ps(c, one));
+    }
+    _mm_store_ss(&sum, offset);
+#endif
+    for (; x < w; ++x) {
+        sum += row[x];
+        float c = std::fabs(sum);
+        if (rule == FILL_EVEN_ODD) {
+            c -= 2 * std::floor(c * 0.5f);
+            c = std::min(c, 2 - c);
+        }
+        row[x] = std::min(c, 1.0f);
+    }
+}
+
+inline void rasterBin(BZrasterizer& r, int layer, const BZrasterLayer& l, int tiles) {
+    std::vector<int>& first = r.binFirst[layer];
+    std::vector<int>& segs = r.binSegs[layer];
+    first.assign(tiles + 1, 0);
+    int n = int(l.segs.size() / 2);
+    auto range = [&](int s, int& lo, int& hi) {
+        float y0 = std::min(l.segs[2 * s].y, l.segs[2 * s + 1].y);
+        float y1 = std::max(l.segs[2 * s].y, l.segs[2 * s + 1].y);
+        lo = std::max(int(std::floor(y0 / RASTER_TILE)), 0);
+        hi = std::min(int(std::floor(y1 / RASTER_TILE)), tiles - 1);
+    };
+    int lo, hi;
+    for (int s = 0; s < n; ++s) {
+        range(s, lo, hi);
+        for (int t = lo; t <= hi; ++t)
+            ++first[t + 1];
+    }
+    for (int t = 0; t < tiles; ++t)
+        first[t + 1] += first[t];
+    segs.resize(first[tiles]);
+    std::vector<int> at(first.begin(), first.end() - 1);
+    for (int s = 0; s < n; ++s) {
+        range(s, lo, hi);
+        for (int t = lo; t <= hi; ++t)
+            segs[at[t]++] = s;
+    }
+}
+
+// Renders the layers into a w x h gray image on the pool.
+inline void rasterRender(BZpool& pool, BZrasterizer& r, const std::vector<BZrasterLayer>& layers,
+                         int w, int h, BZimage& img) {
+    img.w = w;
+    img.h = h;
+    img.gray.assign(size_t(w) * h, 255);
+    int tiles = (h + RASTER_TILE - 1) / RASTER_TILE;
+    int layerCount = int(layers.size());
+    r.binFirst.resize(layerCount);
+    r.binSegs.resize(layerCount);
+    for (int l = 0; l < layerCount; ++l)
+        rasterBin(r, l, layers[l], tiles);
+
+    // Two spare cells per row for the right-hand spill of edges at x = w.
+    int stride = (w + 2 + 3) & ~3;
+    r.workers.resize(poolSize(pool));
+    for (BZrasterWorker& wk : r.workers) {
+        wk.acc.resize(size_t(stride) * RASTER_TILE);
+        wk.shade.resize(size_t(w) * RASTER_TILE);
+    }
+    poolFor(pool, tiles, 1, [&](int lo, int hi, int worker) {
+        BZrasterWorker& wk = r.workers[worker];
+        for (int t = lo; t < hi; ++t) {
+            int y0 = t * RASTER_TILE, rows = std::min(RASTER_TILE, h - y0);
+            std::fill(wk.shade.begin(), wk.shade.begin() + size_t(w) * rows, 1.0f);
+            for (int l = 0; l < layerCount; ++l) {
+                const BZrasterLayer& layer = layers[l];
+                int b0 = r.binFirst[l][t], b1 = r.binFirst[l][t + 1];
+                if (b0 == b1) continue;
+                std::fill(wk.acc.begin(), wk.acc.begin() + size_t(stride) * rows, 0.0f);
+                for (int b = b0; b < b1; ++b) {
+                    int s = r.binSegs[l][b];
+                    rasterEdge(wk.acc.data(), stride, w, y0, rows, layer.segs[2 * s], layer.segs[2 * s + 1]);
+                }
+                for (int y = 0; y < rows; ++y) {
+                    float* cov = wk.acc.data() + size_t(y) * stride;
+                    float* shade = wk.shade.data() + size_t(y) * w;
+                    rasterCoverage(cov, w, layer.rule);
+                    for (int x = 0; x < w; ++x)
+                        shade[x] *= 1 - layer.ink * cov[x];
+                }
+            }
+            uint8_t* out = img.gray.data() + size_t(y0) * w;
+            for (size_t i = 0; i < size_t(w) * rows; ++i)
+                out[i] = uint8_t(wk.shade[i] * 255 + 0.5f);
+        }
+    });
+}
+
+struct BZrenderOptions {
+    int size = 1024;            // longest image side in pixels
+    float margin = 8;           // pixels
+    float strokePx = 1;         // 0 for no strokes
+    StrokeJoin join = JOIN_ROUND;
+    StrokeCap cap = CAP_ROUND;
+    bool fill = false;          // fill each curve, closed by its chord
+    FillRule rule = FILL_NONZERO;
+    float tolPx = 0.25f;
+};
+
+// Builds the fill and stroke layers of a document, fitted into the image
+// with +y up, and renders them.
+inline void renderDocument(BZpool& pool, const BZdocView& v, const BZrenderOptions& o, BZimage& img) {
+    BZbox box;
+    BZscratch s;
+    for (uint32_t c = 0; c < v.curveCount; ++c)
+        box.grow(hullBox(v.pts + v.curves[c].first, int(v.curves[c].count)));
+    if (!(box.x1 >= box.x0)) box = { 0, 0, 1, 1 };
+    float bw = std::max(box.x1 - box.x0, 1e-6f), bh = std::max(box.y1 - box.y0, 1e-6f);
+    float scale = std::max(o.size - 2 * o.margin, 1.0f) / std::max(bw, bh);
+    int w = std::max(int(std::ceil(bw * scale + 2 * o.margin)), 1);
+    int h = std::max(int(std::ceil(bh * scale + 2 * o.margin)), 1);
+
+    std::vector<BZrasterLayer> layers(2);
+    layers[0].rule = o.rule;
+    layers[0].ink = 0.35f;
+    layers[1].rule = FILL_NONZERO;
+    BZstrokeStyle st;
+    st.width = o.strokePx;
+    st.join = o.join;
+    st.cap = o.cap;
+    st.tol = o.tolPx;
+    BZstrokeScratch ss;
+    std::vector<BZpoint> poly((1 << ADAPT_MAX_DEPTH) + 1), strip;
+    for (uint32_t c = 0; c < v.curveCount; ++c) {
+        const BZpoint* p = v.pts + v.curves[c].first;
+        int n = int(v.curves[c].count);
+        if (n < 2) continue;
+        int count = bezierAdaptive(p, n, o.tolPx / scale, poly.data(), int(poly.size()), s);
+        for (int i = 0; i < count; ++i)
+            poly[i] = { (poly[i].x - box.x0) * scale + o.margin, (box.y1 - poly[i].y) * scale + o.margin };
+        if (o.fill)
+            rasterAddContour(layers[0], poly.data(), count);
+        if (o.strokePx > 0) {
+            strip.resize(strokeMaxVerts(count, st));
+            int sv = strokePolyline(poly.data(), count, st, strip.data(), ss);
+            rasterAddStrip(layers[1], strip.data(), sv);
+        }
+    }
+    BZrasterizer r;
+    rasterRender(pool, r, layers, w, h, img);
+}
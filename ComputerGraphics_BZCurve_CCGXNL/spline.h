@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "bezier.h"
+#include "tessellate.h"
+
+// Composite curve of cubic segments over the control points, as an
+// alternative to one global Bezier of degree pts.size() - 1. Each segment
+// depends on four neighbouring points, so moving a point only touches a
+// constant number of segments.
+//
+// SPLINE_BSPLINE: uniform cubic B-spline (C2), end points tripled so the
+//   curve starts and ends on the first and last points.
+// SPLINE_CATMULL_ROM: Catmull-Rom (C1), passes through every point.
+enum SplineKind { SPLINE_BSPLINE, SPLINE_CATMULL_ROM };
+
+// Vertices per segment; segments don't share end vertices so each one owns a
+// fixed slice of the vertex array.
+const int SEG_VERTS = 33;
+
+struct BZspline {
+    SplineKind kind = SPLINE_BSPLINE;
+    std::vector<BZpoint> verts;
+    int segs = 0;
+    int dirtyLo = 0, dirtyHi = -1;   // segments changed since the last upload
+    BZscratch scratch;
+    BZfwdDiff fd;
+};
+
+// Index of the first of the four points segment s uses (before clamping).
+inline int splineBase(SplineKind kind, int s) {
+    return kind == SPLINE_BSPLINE ? s - 2 : s - 1;
+}
+
+inline int splineSegments(SplineKind kind, int m) {
+    if (m < 2) return 0;
+    return kind == SPLINE_BSPLINE ? m + 1 : m - 1;
+}
+
+// Cubic Bezier control points of segment s.
+inline void splineSegment(SplineKind kind, const BZpoint* p, int m, int s, BZpoint b[4]) {
+    int base = splineBase(kind, s);
+    BZpoint q[4];
+    for (int i = 0; i < 4; ++i)
+        q[i] = p[std::min(std::max(base + i, 0), m - 1)];
+    if (kind == SPLINE_BSPLINE) {
+        b[0] = q[0].add(q[1].mult(4)).add(q[2]).mult(1.0f / 6);
+        b[1] = q[1].mult(2).add(q[2]).mult(1.0f / 3);
+        b[2] = q[1].add(q[2].mult(2)).mult(1.0f / 3);
+        b[3] = q[1].add(q[2].mult(4)).add(q[3]).mult(1.0f / 6);
+    }
+    else {
+        b[0] = q[1];
+        b[1] = q[1].add(q[2].add(q[0].mult(-1)).mult(1.0f / 6));
+        b[2] = q[2].add(q[3].add(q[1].mult(-1)).mult(-1.0f / 6));
+        b[3] = q[2];
+    }
+}
+
+inline void splineTessSegment(BZspline& sp, const BZpoint* p, int m, int s) {
+    BZpoint b[4];
+    splineSegment(sp.kind, p, m, s, b);
+    bezierFwdDiff(b, 4, SEG_VERTS, sp.verts.data() + size_t(s) * SEG_VERTS, sp.fd, sp.scratch);
+}
+
+inline void splineMarkDirty(BZspline& sp, int lo, int hi) {
+    if (sp.dirtyLo > sp.dirtyHi) {
+        sp.dirtyLo = lo;
+        sp.dirtyHi = hi;
+    }
+    else {
+        sp.dirtyLo = std::min(sp.dirtyLo, lo);
+        sp.dirtyHi = std::max(sp.dirtyHi, hi);
+    }
+}
+
+// Re-tessellates every segment (after inserts, erases or a kind change).
+inline void splineRebuild(BZspline& sp, const BZpoint* p, int m) {
+    sp.segs = splineSegments(sp.kind, m);
+    if (sp.verts.size() < size_t(sp.segs) * SEG_VERTS)
+        sp.verts.resize(size_t(sp.segs) * SEG_VERTS);
+    for (int s = 0; s < sp.segs; ++s)
+        splineTessSegment(sp, p, m, s);
+    sp.dirtyLo = 0;
+    sp.dirtyHi = sp.segs - 1;
+}
+
+// Re-tessellates only the segments that depend on point j.
+inline void splineMovePoint(BZspline& sp, const BZpoint* p, int m, int j) {
+    int off = -splineBase(sp.kind, 0);
+    int lo = std::max(j + off - 3, 0);
+    int hi = std::min(j + off, sp.segs - 1);
+    for (int s = lo; s <= hi; ++s)
+        splineTessSegment(sp, p, m, s);
+    if (lo <= hi)
+        splineMarkDirty(sp, lo, hi);
+}
+
+inline int splineVertexCount(const BZspline& sp) {
+    return sp.segs * SEG_VERTS;
+}
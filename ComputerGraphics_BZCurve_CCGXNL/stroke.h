@@ -0,0 +1,220 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "bezier.h"
+#include "bzsimd.h"
+
+// Wide strokes: a polyline becomes one GL_TRIANGLE_STRIP of left/right
+// vertex pairs. Each segment is the quad between the pair ending the
+// previous join and the pair starting the next one; joins and caps add
+// extra pairs. On the inner side of a join both pairs share the inner
+// miter point, so the outer side fans around it; where the inner miter
+// would reach past a neighbouring segment the inner side keeps the two
+// plain offsets instead and the strip folds over itself, which still
+// covers the right area with opaque fills.
+//
+// The first pass computes unit tangents and lengths of all segments at
+// once (four per SSE2 step); the second walks the segments and writes
+// straight into the caller's buffer, which strokeMaxVerts() sizes.
+// Zero-length segments are skipped. Round joins and caps are split so the
+// chords stay within tol of the arc.
+
+enum StrokeJoin { JOIN_MITER, JOIN_ROUND, JOIN_BEVEL };
+enum StrokeCap { CAP_BUTT, CAP_SQUARE, CAP_ROUND };
+
+const char* const JOIN_NAMES[] = { "miter", "round", "bevel" };
+const char* const CAP_NAMES[] = { "butt", "square", "round" };
+
+const float STROKE_MIN_LEN = 1e-9f;
+const int STROKE_MAX_ARC = 64;   // chords per half turn
+
+struct BZstrokeStyle {
+    float width = 0.01f;
+    StrokeJoin join = JOIN_MITER;
+    StrokeCap cap = CAP_BUTT;
+    float miterLimit = 4;        // miter length / width, as in SVG
+    float tol = 0.001f;          // for round joins and caps
+};
+
+struct BZstrokeScratch {
+    std::vector<float> tx, ty, len;
+};
+
+// Chords per half turn for round joins and caps.
+inline int strokeArcSteps(const BZstrokeStyle& st) {
+    float h = st.width * 0.5f;
+    if (h <= st.tol) return 1;
+    float step = 2 * std::acos(1 - st.tol / h);
+    return std::min(std::max(int(std::ceil(3.14159265f / step)), 1), STROKE_MAX_ARC);
+}
+
+// Upper bound on the vertices strokePolyline() writes for n points.
+inline int strokeMaxVerts(int n, const BZstrokeStyle& st) {
+    if (n < 2) return 0;
+    int arc = strokeArcSteps(st);
+    int joinPairs = st.join == JOIN_ROUND ? arc + 1 : 2;
+    int capPairs = st.cap == CAP_ROUND ? arc / 2 + 2 : 1;
+    return 2 * (2 * capPairs + (n - 2) * joinPairs);
+}
+
+// Unit tangents and lengths of the n - 1 segments; zero-length ones get a
+// zero tangent.
+inline void strokeTangents(const BZpoint* p, int n, float* tx, float* ty, float* len) {
+    int m = n - 1, i = 0;
+#if BZ_X86
+    const __m128 eps = _mm_set1_ps(STROKE_MIN_LEN), one = _mm_set1_ps(1);
+    for (; i + 4 <= m; i += 4) {
+        // p[i..i+4] as x0 y0 x1 y1 | x2 y2 x3 y3 and, one point on, as the ends.
+        __m128 a01 = _mm_loadu_ps(&p[i].x), a23 = _mm_loadu_ps(&p[i + 2].x);
+        __m128 b01 = _mm_loadu_ps(&p[i + 1].x), b23 = _mm_loadu_ps(&p[i + 3].x);
+        __m128 ax = _mm_shuffle_ps(a01, a23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 ay = _mm_shuffle_ps(a01, a23, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 bx = _mm_shuffle_ps(b01, b23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 by = _mm_shuffle_ps(b01, b23, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 dx = _mm_sub_ps(bx, ax), dy = _mm_sub_ps(by, ay);
+        __m128 l = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        __m128 inv = _mm_and_ps(_mm_cmpgt_ps(l, eps), _mm_div_ps(one, _mm_max_ps(l, eps)));
+        _mm_storeu_ps(tx + i, _mm_mul_ps(dx, inv));
+        _mm_storeu_ps(ty + i, _mm_mul_ps(dy, inv));
+        _mm_storeu_ps(len + i, l);
+    }
+#endif
+    for (; i < m; ++i) {
+        float dx = p[i + 1].x - p[i].x, dy = p[i + 1].y - p[i].y;
+        float l = std::sqrt(dx * dx + dy * dy);
+        float inv = l > STROKE_MIN_LEN ? 1 / l : 0;
+        tx[i] = dx * inv;
+        ty[i] = dy * inv;
+        len[i] = l;
+    }
+}
+
+struct BZstrokeOut {
+    BZpoint* v;
+    int count;
+    void pair(BZpoint l, BZpoint r) {
+        v[count++] = l;
+        v[count++] = r;
+    }
+};
+
+// Cap at c facing away from the stroke along -dir (start) or dir (end).
+inline void strokeCap(BZstrokeOut& o, BZpoint c, float tx, float ty, float h, StrokeCap cap, int arc, bool start) {
+    float s = start ? -1.0f : 1.0f;
+    BZpoint n = { -ty * h, tx * h }, t = { tx * h * s, ty * h * s };
+    if (cap == CAP_SQUARE) {
+        c = c.add(t);
+        o.pair(c.add(n), c.add(n.mult(-1)));
+        return;
+    }
+    if (cap == CAP_BUTT) {
+        o.pair(c.add(n), c.add(n.mult(-1)));
+        return;
+    }
+    // Pairs symmetric about the axis, from the tip to the sides (start) or
+    // back (end).
+    int k = arc / 2 + 1;
+    for (int j = 0; j <= k; ++j) {
+        float a = 1.5707963f * (start ? j : k - j) / k;
+        float ca = std::cos(a), sa = std::sin(a);
+        BZpoint along = c.add(t.mult(ca)), side = n.mult(sa);
+        o.pair(along.add(side), along.add(side.mult(-1)));
+    }
+}
+
+// Strokes the n-point polyline p into out as a triangle strip; returns the
+// vertex count, at most strokeMaxVerts(n, st).
+inline int strokePolyline(const BZpoint* p, int n, const BZstrokeStyle& st, BZpoint* out, BZstrokeScratch& s) {
+    if (n < 2) return 0;
+    int m = n - 1;
+    if (int(s.len.size()) < m) {
+        s.tx.resize(m);
+        s.ty.resize(m);
+        s.len.resize(m);
+    }
+    float* tx = s.tx.data();
+    float* ty = s.ty.data();
+    float* len = s.len.data();
+    strokeTangents(p, n, tx, ty, len);
+
+    int a = 0;
+    while (a < m && len[a] <= STROKE_MIN_LEN) ++a;
+    if (a == m) return 0;
+    float h = st.width * 0.5f;
+    int arc = strokeArcSteps(st);
+    float arcStep = 3.14159265f / arc;
+    float limit2 = st.miterLimit * st.miterLimit;
+    BZstrokeOut o = { out, 0 };
+    strokeCap(o, p[a], tx[a], ty[a], h, st.cap, arc, true);
+
+    int i = a;
+    for (int j = a + 1; j < m; ++j) {
+        if (len[j] <= STROKE_MIN_LEN) continue;
+        BZpoint P = p[j];
+        float dot = tx[i] * tx[j] + ty[i] * ty[j];
+        float cross = tx[i] * ty[j] - ty[i] * tx[j];
+        BZpoint n0 = { -ty[i] * h, tx[i] * h }, n1 = { -ty[j] * h, tx[j] * h };
+        if (std::fabs(cross) < 1e-6f && dot > 0) {
+            o.pair(P.add(n0), P.add(n0.mult(-1)));
+            i = j;
+            continue;
+        }
+        // Outer side: +normal when turning right (cross < 0).
+        float side = cross < 0 ? 1.0f : -1.0f;
+        // Miter offset m = (n0 + n1) / (1 + dot), |m| = h / cos(half turn).
+        float den = 1 + dot;
+        BZpoint miter = den > 1e-6f ? n0.add(n1).mult(1 / den) : BZpoint{ 0, 0 };
+        // The inner miter reaches h * tan(half turn) along both segments.
+        bool innerOk = den > 1e-6f && h * std::fabs(cross) <= den * std::min(len[i], len[j]);
+        BZpoint in0 = innerOk ? P.add(miter.mult(-side)) : P.add(n0.mult(-side));
+        BZpoint in1 = innerOk ? in0 : P.add(n1.mult(-side));
+        BZpoint out0 = P.add(n0.mult(side)), out1 = P.add(n1.mult(side));
+        // Pairs are (left, right); the outer point is left when side > 0.
+        auto emit = [&](BZpoint outer, BZpoint inner) {
+            if (side > 0) o.pair(outer, inner);
+            else o.pair(inner, outer);
+        };
+
+        if (st.join == JOIN_MITER && den > 1e-6f && 2 / den <= limit2) {
+            // |m|^2 / h^2 = 2 / (1 + dot)
+            BZpoint tip = P.add(miter.mult(side));
+            emit(tip, in0);
+            if (!innerOk) emit(tip, in1);
+        }
+        else if (st.join == JOIN_ROUND) {
+            float turn = std::atan2(cross, dot);
+            // Rounding can ask for one step too many on a full reversal.
+            int k = std::min(std::max(int(std::ceil(std::fabs(turn) / arcStep)), 1), arc);
+            emit(out0, in0);
+            for (int q = 1; q < k; ++q) {
+                float ang = turn * q / k, c = std::cos(ang), sn = std::sin(ang);
+                BZpoint r = { n0.x * c - n0.y * sn, n0.x * sn + n0.y * c };
+                emit(P.add(r.mult(side)), in0);
+            }
+            emit(out1, in1);
+        }
+        else {
+            emit(out0, in0);
+            emit(out1, in1);
+        }
+        i = j;
+    }
+    strokeCap(o, p[i + 1], tx[i], ty[i], h, st.cap, arc, false);
+    return o.count;
+}
+
+// Strokes count polylines stored back to back in verts (first/count per
+// polyline) into out, which must hold the sum of their strokeMaxVerts();
+// outFirst/outCount receive the strips for glMultiDrawArrays.
+inline int strokeBatch(const BZpoint* verts, const uint32_t* first, const uint32_t* count, int polys,
+                       const BZstrokeStyle& st, BZpoint* out, int* outFirst, int* outCount, BZstrokeScratch& s) {
+    int total = 0;
+    for (int c = 0; c < polys; ++c) {
+        outFirst[c] = total;
+        outCount[c] = strokePolyline(verts + first[c], int(count[c]), st, out + total, s);
+        total += outCount[c];
+    }
+    return total;
+}
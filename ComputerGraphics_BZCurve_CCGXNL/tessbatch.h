@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "bezier.h"
+#include "tessellate.h"
+#include "threadpool.h"
+#include "bzfile.h"
+
+// Tessellation of many curves on a BZpool. Each curve is sampled uniformly
+// with the segment count from Wang's formula, which bounds the distance
+// between the curve and its polyline by tol. Counts are known before any
+// curve is tessellated, so every curve gets a fixed slice of one vertex
+// buffer and the workers write their slices without synchronization; the
+// caller uploads the buffer afterwards.
+
+const int BATCH_MAX_SEGMENTS = 1 << 16;
+const int BATCH_GRAIN = 16;   // curves per work item
+
+// Wang's formula: d (d - 1) / 8 * max |p[i+2] - 2 p[i+1] + p[i]| / tol
+// is a bound for the squared segment count.
+inline int wangSegments(const BZpoint* p, int n, float tol) {
+    int d = n - 1;
+    if (d < 2) return 1;
+    float m = 0;
+    for (int i = 0; i + 2 < n; ++i) {
+        float x = p[i + 2].x - 2 * p[i + 1].x + p[i].x;
+        float y = p[i + 2].y - 2 * p[i + 1].y + p[i].y;
+        m = std::max(m, x * x + y * y);
+    }
+    double segs = std::ceil(std::sqrt(d * (d - 1) / 8.0 * std::sqrt(double(m)) / tol));
+    return int(std::min(std::max(segs, 1.0), double(BATCH_MAX_SEGMENTS)));
+}
+
+struct BZtessWorker {
+    BZscratch scratch;
+    BZfwdDiff fd;
+    std::vector<float> ts;
+};
+
+struct BZtessBatch {
+    std::vector<BZpoint> verts;
+    std::vector<uint32_t> first, count;   // slice of each listed curve
+    std::vector<BZtessWorker> workers;
+};
+
+// Tessellates the listed curves of v into b; slice k belongs to curves[k].
+inline void tessBatch(BZpool& pool, BZtessBatch& b, const BZdocView& v,
+                      const int* curves, int curveCount, float tol) {
+    b.first.resize(curveCount);
+    b.count.resize(curveCount);
+    size_t total = 0;
+    for (int k = 0; k < curveCount; ++k) {
+        const BZcurveRec& c = v.curves[curves[k]];
+        b.first[k] = uint32_t(total);
+        b.count[k] = c.count >= 2 ? uint32_t(wangSegments(v.pts + c.first, int(c.count), tol) + 1) : 0;
+        total += b.count[k];
+    }
+    b.verts.resize(total);
+    if (b.workers.size() < size_t(poolSize(pool)))
+        b.workers.resize(poolSize(pool));
+
+    poolFor(pool, curveCount, BATCH_GRAIN, [&](int lo, int hi, int worker) {
+        BZtessWorker& w = b.workers[worker];
+        for (int k = lo; k < hi; ++k) {
+            int count = int(b.count[k]);
+            if (!count) continue;
+            const BZcurveRec& c = v.curves[curves[k]];
+            if (w.ts.size() < size_t(count))
+                w.ts.resize(count);
+            uniformParams(w.ts.data(), count);
+            tessUniform(v.pts + c.first, int(c.count), w.ts.data(), count, b.verts.data() + b.first[k], w.fd, w.scratch);
+        }
+    });
+}
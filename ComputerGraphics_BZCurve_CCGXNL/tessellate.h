@@ -0,0 +1,255 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include "bezier.h"
+#include "bzsimd.h"
+#include "bernstein.h"
+
+enum TessMode { TESS_DECASTELJAU, TESS_FWDDIFF, TESS_BERNSTEIN };
+
+// Forward differencing loses precision quickly with degree; past this the
+// uniform tessellator falls back to de Casteljau.
+const int FD_MAX_DEGREE = 16;
+// Samples between re-seeds of the difference table.
+const int FD_RESEED = 64;
+// Largest drift (NDC units) tolerated at a re-seed before falling back.
+const float FD_DRIFT_TOL = 1e-4f;
+
+// Difference table state for uniformly stepping one curve.
+struct BZfwdDiff {
+    std::vector<double> ax, ay;   // power-basis coefficients
+    std::vector<double> dx, dy;   // forward differences at the current sample
+    int reseeds = 0;
+    int fallbacks = 0;
+    float maxDrift = 0;
+
+    void resetStats() { reseeds = 0; fallbacks = 0; maxDrift = 0; }
+};
+
+inline void fdPowerBasis(const BZpoint* p, int n, BZfwdDiff& fd) {
+    int d = n - 1;
+    if (int(fd.ax.size()) < n) {
+        fd.ax.resize(n); fd.ay.resize(n);
+        fd.dx.resize(n); fd.dy.resize(n);
+    }
+    // a_k = C(d,k) * sum_i (-1)^(k-i) C(k,i) P_i
+    double cdk = 1;
+    for (int k = 0; k <= d; ++k) {
+        double sx = 0, sy = 0, cki = 1;
+        for (int i = 0; i <= k; ++i) {
+            double sgn = ((k - i) & 1) ? -1.0 : 1.0;
+            sx += sgn * cki * p[i].x;
+            sy += sgn * cki * p[i].y;
+            cki = cki * (k - i) / (i + 1);
+        }
+        fd.ax[k] = cdk * sx;
+        fd.ay[k] = cdk * sy;
+        cdk = cdk * (d - k) / (k + 1);
+    }
+}
+
+// k! * S(m, k) (Stirling numbers of the second kind): the k-th forward
+// difference at 0 of u^m with unit step.
+struct FDsurjections {
+    double tab[(FD_MAX_DEGREE + 1) * (FD_MAX_DEGREE + 1)] = {};
+
+    FDsurjections() {
+        const int w = FD_MAX_DEGREE + 1;
+        tab[0] = 1;
+        for (int m = 1; m < w; ++m)
+            for (int k = 1; k <= m; ++k)
+                tab[m * w + k] = k * (tab[(m - 1) * w + k] + tab[(m - 1) * w + k - 1]);
+    }
+};
+
+inline const double* fdSurjections() {
+    static const FDsurjections s;
+    return s.tab;
+}
+
+// Rebuilds the difference table at parameter t for step h. The curve is
+// Taylor-shifted to t and the differences taken analytically, rather than by
+// differencing sampled values, which would cancel most of the precision.
+inline void fdSeed(int n, double t, double h, BZfwdDiff& fd) {
+    int d = n - 1;
+    const double* sur = fdSurjections();
+    const int w = FD_MAX_DEGREE + 1;
+    double* bx = fd.dx.data();
+    double* by = fd.dy.data();
+    for (int k = 0; k <= d; ++k) {
+        bx[k] = fd.ax[k];
+        by[k] = fd.ay[k];
+    }
+    for (int i = 0; i < d; ++i)
+        for (int k = d - 1; k >= i; --k) {
+            bx[k] += t * bx[k + 1];
+            by[k] += t * by[k + 1];
+        }
+    double hm = 1;
+    for (int m = 0; m <= d; ++m) {
+        bx[m] *= hm;
+        by[m] *= hm;
+        hm *= h;
+    }
+    for (int k = 1; k <= d; ++k) {
+        double sx = 0, sy = 0;
+        for (int m = k; m <= d; ++m) {
+            sx += bx[m] * sur[m * w + k];
+            sy += by[m] * sur[m * w + k];
+        }
+        bx[k] = sx;
+        by[k] = sy;
+    }
+    ++fd.reseeds;
+}
+
+// Uniform tessellation at t = j / (count - 1) by forward differencing: O(n)
+// adds per sample once seeded. Every FD_RESEED samples the running value is
+// compared with de Casteljau and the table re-seeded; if the drift exceeds
+// FD_DRIFT_TOL the remaining samples are evaluated with de Casteljau instead.
+// The difference table only goes up to FD_MAX_DEGREE; higher degrees are
+// evaluated with de Casteljau throughout.
+inline void bezierFwdDiff(const BZpoint* p, int n, int count, BZpoint* out,
+                          BZfwdDiff& fd, BZscratch& s) {
+    if (n <= 0 || count <= 0) return;
+    BZpoint* tmp = s.get(n);
+    if (n - 1 > FD_MAX_DEGREE) {
+        for (int j = 0; j < count; ++j)
+            out[j] = bezierEval(count > 1 ? float(j) / float(count - 1) : 0.0f, p, n, tmp);
+        return;
+    }
+    double h = count > 1 ? 1.0 / (count - 1) : 0.0;
+    int d = n - 1;
+    fdPowerBasis(p, n, fd);
+
+    for (int j = 0; j < count; ++j) {
+        if (j % FD_RESEED == 0 || j == count - 1) {
+            float t = count > 1 ? float(j) / float(count - 1) : 0.0f;
+            if (j > 0) {
+                BZpoint ref = bezierEval(t, p, n, tmp);
+                float drift = BZpoint{ float(fd.dx[0]), float(fd.dy[0]) }.dist(ref);
+                if (drift > fd.maxDrift) fd.maxDrift = drift;
+                if (drift > FD_DRIFT_TOL) {
+                    ++fd.fallbacks;
+                    for (; j < count; ++j)
+                        out[j] = bezierEval(float(j) / float(count - 1), p, n, tmp);
+                    return;
+                }
+            }
+            fdSeed(n, j * h, h, fd);
+        }
+        out[j] = { float(fd.dx[0]), float(fd.dy[0]) };
+        for (int k = 0; k < d; ++k) {
+            fd.dx[k] += fd.dx[k + 1];
+            fd.dy[k] += fd.dy[k + 1];
+        }
+    }
+}
+
+// Uniform sampling entry point: forward differences for low degrees, the
+// O(n) Bernstein walk for very high ones, SIMD de Casteljau in between.
+// ts is not read on the forward-difference path.
+inline TessMode tessUniform(const BZpoint* p, int n, const float* ts, int count,
+                            BZpoint* out, BZfwdDiff& fd, BZscratch& s) {
+    if (n - 1 <= FD_MAX_DEGREE) {
+        bezierFwdDiff(p, n, count, out, fd, s);
+        return TESS_FWDDIFF;
+    }
+    if (n >= HIGH_MIN_POINTS) {
+        bezierBatchHigh(p, n, ts, count, out);
+        return TESS_BERNSTEIN;
+    }
+    bezierBatchSimd(p, n, ts, count, out, s);
+    return TESS_DECASTELJAU;
+}
+
+// Arbitrary parameters: the cheapest evaluator for the degree.
+inline void bezierBatchAuto(const BZpoint* p, int n, const float* ts, int count,
+                            BZpoint* out, BZscratch& s) {
+    if (n <= 4)
+        bezierBatchFast(p, n, ts, count, out, s);
+    else if (n >= HIGH_MIN_POINTS)
+        bezierBatchHigh(p, n, ts, count, out);
+    else
+        bezierBatchSimd(p, n, ts, count, out, s);
+}
+
+// Subdivision depth limit for the adaptive tessellator (at most 2^depth segments).
+const int ADAPT_MAX_DEPTH = 16;
+
+// Squared distance from q to segment ab.
+inline float segDist2(BZpoint q, BZpoint a, BZpoint b) {
+    float ex = b.x - a.x, ey = b.y - a.y;
+    float qx = q.x - a.x, qy = q.y - a.y;
+    float len2 = ex * ex + ey * ey;
+    float u = len2 > 0 ? (qx * ex + qy * ey) / len2 : 0.0f;
+    u = u < 0 ? 0 : (u > 1 ? 1 : u);
+    float dx = qx - u * ex, dy = qy - u * ey;
+    return dx * dx + dy * dy;
+}
+
+// The curve lies in the convex hull of its control points, so if every
+// interior point is within tol of the chord the chord is within tol of the curve.
+inline bool isFlat(const BZpoint* p, int n, float tol) {
+    float tol2 = tol * tol;
+    for (int i = 1; i < n - 1; ++i)
+        if (segDist2(p[i], p[0], p[n - 1]) > tol2)
+            return false;
+    return true;
+}
+
+// Splits p at t = 0.5 into left and right halves (n points each).
+inline void splitHalf(const BZpoint* p, int n, BZpoint* left, BZpoint* right, BZpoint* tmp) {
+    for (int i = 0; i < n; ++i)
+        tmp[i] = p[i];
+    left[0] = tmp[0];
+    right[n - 1] = tmp[n - 1];
+    for (int k = 1; k < n; ++k) {
+        for (int i = 0; i < n - k; ++i)
+            tmp[i] = tmp[i].mult(0.5f).add(tmp[i + 1].mult(0.5f));
+        left[k] = tmp[0];
+        right[n - 1 - k] = tmp[n - 1 - k];
+    }
+}
+
+// Adaptive tessellation: recursively halves the curve until each piece is
+// flat to within tol (curve units) and emits the piece endpoints. Writes at
+// most cap points and returns the count; the last point is always p[n-1].
+inline int bezierAdaptive(const BZpoint* p, int n, float tol, BZpoint* out, int cap, BZscratch& s) {
+    if (n <= 0 || cap <= 0) return 0;
+    out[0] = p[0];
+    if (n == 1 || cap == 1) return 1;
+
+    // Depth-first stack of pending pieces, n points each, plus split buffers.
+    BZpoint* stack = s.get(size_t(n) * (ADAPT_MAX_DEPTH + 4));
+    BZpoint* right = stack + size_t(n) * (ADAPT_MAX_DEPTH + 2);
+    BZpoint* tmp = right + n;
+    int depth[ADAPT_MAX_DEPTH + 2];
+    int top = 0, count = 1;
+    for (int i = 0; i < n; ++i)
+        stack[i] = p[i];
+    depth[0] = 0;
+
+    while (top >= 0) {
+        BZpoint* piece = stack + size_t(top) * n;
+        if (count == cap - 1) {
+            out[count++] = p[n - 1];
+            break;
+        }
+        if (depth[top] >= ADAPT_MAX_DEPTH || isFlat(piece, n, tol)) {
+            out[count++] = piece[n - 1];
+            --top;
+            continue;
+        }
+        // The right half replaces the piece and the left half goes on top.
+        BZpoint* left = piece + n;
+        int d = depth[top] + 1;
+        splitHalf(piece, n, left, right, tmp);
+        for (int i = 0; i < n; ++i)
+            piece[i] = right[i];
+        depth[top] = d;
+        depth[top + 1] = d;
+        ++top;
+    }
+    return count;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <utility>
+#include <algorithm>
+
+// Work-stealing pool for parallel loops. poolFor(pool, count, grain, fn)
+// calls fn(lo, hi, worker) over [0, count) in ranges of at most grain
+// indices and returns when all are done. The calling thread takes part as
+// worker 0, so per-worker state can be indexed by worker < poolSize(pool).
+//
+// Every worker starts with an equal contiguous share in its own deque. It
+// halves its range until it is down to grain, pushing the upper halves back
+// on its deque and working on the lower one; a worker that runs dry steals
+// from the front of another deque, which holds the largest pieces left.
+
+typedef std::pair<int, int> BZrange;
+
+struct BZworkQueue {
+    std::mutex m;
+    std::deque<BZrange> ranges;
+};
+
+struct BZpool {
+    std::vector<std::thread> threads;
+    std::unique_ptr<BZworkQueue[]> queues;
+    int size = 1;
+
+    std::mutex m;
+    std::condition_variable wake, done;
+    long long generation = 0;
+    int busy = 0;
+    bool quit = false;
+
+    const std::function<void(int, int, int)>* job = nullptr;
+    int grain = 1;
+    std::atomic<int> remaining{ 0 };
+
+    ~BZpool();
+};
+
+inline int poolSize(const BZpool& p) {
+    return p.size;
+}
+
+inline bool poolPop(BZpool& p, int id, BZrange& r) {
+    BZworkQueue& q = p.queues[id];
+    std::lock_guard<std::mutex> lk(q.m);
+    if (q.ranges.empty()) return false;
+    r = q.ranges.back();
+    q.ranges.pop_back();
+    return true;
+}
+
+inline bool poolSteal(BZpool& p, int id, BZrange& r) {
+    for (int k = 1; k < p.size; ++k) {
+        BZworkQueue& q = p.queues[(id + k) % p.size];
+        std::lock_guard<std::mutex> lk(q.m);
+        if (q.ranges.empty()) continue;
+        r = q.ranges.front();
+        q.ranges.pop_front();
+        return true;
+    }
+    return false;
+}
+
+inline void poolRun(BZpool& p, int id) {
+    BZrange r;
+    while (p.remaining.load() > 0) {
+        if (!poolPop(p, id, r) && !poolSteal(p, id, r)) {
+            // Everything left is in flight on other workers.
+            std::this_thread::yield();
+            continue;
+        }
+        while (r.second - r.first > p.grain) {
+            int mid = r.first + (r.second - r.first) / 2;
+            std::lock_guard<std::mutex> lk(p.queues[id].m);
+            p.queues[id].ranges.push_back({ mid, r.second });
+            r.second = mid;
+        }
+        (*p.job)(r.first, r.second, id);
+        p.remaining -= r.second - r.first;
+    }
+}
+
+inline void poolWorker(BZpool& p, int id) {
+    long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(p.m);
+            p.wake.wait(lk, [&] { return p.quit || p.generation != seen; });
+            if (p.quit) return;
+            seen = p.generation;
+        }
+        poolRun(p, id);
+        std::lock_guard<std::mutex> lk(p.m);
+        if (--p.busy == 0)
+            p.done.notify_all();
+    }
+}
+
+inline void poolStop(BZpool& p) {
+    {
+        std::lock_guard<std::mutex> lk(p.m);
+        p.quit = true;
+    }
+    p.wake.notify_all();
+    for (std::thread& t : p.threads)
+        t.join();
+    p.threads.clear();
+    p.quit = false;
+    p.size = 1;
+}
+
+inline BZpool::~BZpool() {
+    poolStop(*this);
+}
+
+// threads counts the caller; 0 uses every core.
+inline void poolStart(BZpool& p, int threads) {
+    poolStop(p);
+    if (threads <= 0)
+        threads = int(std::thread::hardware_concurrency());
+    p.size = std::max(threads, 1);
+    p.queues.reset(new BZworkQueue[p.size]);
+    p.generation = 0;
+    for (int id = 1; id < p.size; ++id)
+        p.threads.emplace_back(poolWorker, std::ref(p), id);
+}
+
+inline void poolFor(BZpool& p, int count, int grain, const std::function<void(int, int, int)>& fn) {
+    if (count <= 0) return;
+    if (!p.queues) poolStart(p, 1);
+    p.job = &fn;
+    p.grain = std::max(grain, 1);
+    for (int id = 0; id < p.size; ++id) {
+        int lo = int((long long)count * id / p.size), hi = int((long long)count * (id + 1) / p.size);
+        if (lo < hi)
+            p.queues[id].ranges.push_back({ lo, hi });
+    }
+    p.remaining = count;
+    {
+        std::lock_guard<std::mutex> lk(p.m);
+        p.busy = p.size - 1;
+        ++p.generation;
+    }
+    p.wake.notify_all();
+    poolRun(p, 0);
+    std::unique_lock<std::mutex> lk(p.m);
+    p.done.wait(lk, [&] { return p.busy == 0; });
+    p.job = nullptr;
+}